@@ -1,9 +1,16 @@
 %{
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <set>
+#include <thread>
 
+#include "parseTreeWriter.h"
+#include "semanticAnalyzer.h"
 #include "symbolInfo.h"
 #include "symbolTable.h"
 
@@ -13,119 +20,252 @@
 
     extern FILE* yyin;
     SymbolTable* symbolTable = new SymbolTable();
-    SymbolInfo* argumentInfo = new SymbolInfo();
     extern int yylineno;
     extern int errorCount;
 
     FILE* fp;
     FILE* logout;
+    FILE* logFile;
     FILE* errorout;
     FILE* parseTreeOut;
 
+    // PARSE_TREE_STREAM=1 writes every unit out as soon as it is reduced and frees it,
+    // units go to a spill file first since their indentation depends on how many follow
+    bool streamParseTree = false;
+    ParseTreeWriter parseTreeWriter;
+    FILE* unitsOut;
+    vector<long> unitEnds;
+
+    // semantic analysis runs on finished units, the function bodies on SEMANTIC_THREADS workers
+    // (default: all cores), the parser numbers its reductions so that the diagnostics and the
+    // scope dumps can be put back in the order of a single pass
+    // the log is written to a spill file while parsing, and the dumps are spliced into it
+    // when it is copied to the log file, after every unit when streaming
+    int reductionCount = 0;
+    vector<int> scopeReductions;
+    vector<pair<int, long>> dumpOffsets;  // compound_statement reduction, log offset after its line
+    long logCopied = 0;
+    vector<SymbolInfo*> pendingUnits;
+    vector<Diagnostic> diagnostics;
+    vector<ScopeDump> scopeDumps;
+    SignatureTable signatureTable;
+    DumpFile dumpFile;
+
+    // a syntax error ends the parse before the unit it is in is reduced, the symbols bison
+    // discards from its stack are kept, top first, to check what there is of that unit
+    // the lcurl of a block still open is marked
+    vector<pair<SymbolInfo*, bool>> discardedSymbols;
+
     void yyerror(string s) {
-        errorCount++;
-        fprintf(errorout, "Line# %d: %s\n", yylineno, s.c_str());
+        // a syntax error ends the parse, it comes after everything reduced so far
+        diagnostics.push_back({reductionCount + 1, yylineno, s});
     }
 
     void logOutput(string parent, string child) {
         fprintf(logout, "%s : %s\n", parent.c_str(), child.c_str());
     }
 
-    string errorSymbol(SymbolInfo * info) {
-        return ("'" + info->getName() + "'");
+    // the attributes of a defined function, its declaration is checked by the semantic pass
+    void defineFunction(SymbolInfo* function, SymbolInfo* returnType, SymbolInfo* parameters) {
+        function->setType("FUNCTION");
+        function->setReturnType(returnType->getTypeSpecifier());
+        function->setTypeSpecifier(returnType->getTypeSpecifier());
+        function->setParameters(parameters->getParameters());
+        function->setFunctionDefinition(true);
+        function->setReduction(++reductionCount, yylineno);
     }
 
-    void insertToSymbolTable(SymbolInfo * symbolInfo, string errorText = "Conflicting types for ") {
-        // handle void variable
-        if (symbolInfo->getTypeSpecifier() == "VOID") {
-        	yyerror("Variable or field " + errorSymbol(symbolInfo) +" declared void");
-            return;
+    void buildParseTree(SymbolInfo* left, vector<SymbolInfo*> rights) {
+        left->setChildren(rights);
+        left->setStartLine(rights[0]->getStartLine());
+        left->setReduction(++reductionCount, yylineno);
+    }
+
+    // list rules extend the node of their left operand instead of nesting a new one
+    void buildList(SymbolInfo* list, vector<SymbolInfo*> items) {
+        if (!list->isList()) list->setStartLine(items[0]->getStartLine());
+        list->pushListLink(items);
+        list->setReduction(++reductionCount, yylineno);
+    }
+
+    // pre-order with an explicit stack, a list node prints as the chain of nested nodes
+    // the grammar describes, so the output is the same as for the nested tree
+    void preOrderParaseTree(SymbolInfo* head, int depth) {
+        vector<pair<SymbolInfo*, int>> stack = {{head, depth}};
+        while (!stack.empty()) {
+            SymbolInfo* node = stack.back().first;
+            int depth = stack.back().second;
+            stack.pop_back();
+            node->setDepth(depth);
+            auto& children = node->getChildren();
+
+            if (!node->isList()) {
+                parseTreeWriter.writeNode(node, depth);
+                for (auto it = children.rbegin(); it != children.rend(); it++) stack.push_back({*it, depth + 1});
+                continue;
+            }
+
+            // the last reduction is outermost, the items of the first one are deepest
+            int links = node->getListLinks();
+            for (int link = links - 1; link >= 0; link--) {
+                parseTreeWriter.writeListLink(node, link, depth + links - 1 - link);
+            }
+            for (int link = links - 1; link >= 0; link--) {
+                for (int i = node->getListLinkEnd(link) - 1; i >= node->getListLinkBegin(link); i--) {
+                    stack.push_back({children[i], depth + links - link});
+                }
+            }
+        }
+    }
+
+    // frees the nodes below a written unit, except the symbols the global scope still refers to
+    void releaseUnit(SymbolInfo* unit) {
+        SymbolInfo* declaration = unit->getChildren()[0];
+        set<SymbolInfo*> kept;
+        if (declaration->getSType() == "var_declaration") {
+            for (auto symbolInfo : declaration->getChildren()[1]->getDeclarations()) kept.insert(symbolInfo);
+        } else {
+            SymbolInfo* function = declaration->getChildren()[1];
+            kept.insert(function);
+            for (auto parameter : function->getParameters()) kept.insert(parameter);
         }
 
-        bool inserted = symbolTable->insert(symbolInfo);
-        if (!inserted) {
-            yyerror(errorText + errorSymbol(symbolInfo));
+        set<SymbolInfo*> released;
+        vector<SymbolInfo*> stack = unit->getChildren();
+        unit->setChildren({});
+        while (!stack.empty()) {
+            SymbolInfo* node = stack.back();
+            stack.pop_back();
+            if (!released.insert(node).second) continue;
+            stack.insert(stack.end(), node->getChildren().begin(), node->getChildren().end());
+            if (!kept.count(node)) delete node;
         }
     }
 
-    void insertFunctionDeclaration(SymbolInfo * functionDeclaration) {
-        bool inserted = symbolTable->insert(functionDeclaration);
+    void streamUnit(SymbolInfo* unit) {
+        parseTreeWriter.setOutput(unitsOut);
+        preOrderParaseTree(unit, 0);
+        parseTreeWriter.flush();
+        unitEnds.push_back(ftell(unitsOut));
+        releaseUnit(unit);
+    }
 
-        if (!inserted) {
-            yyerror("Multiple declaration of " + errorSymbol(functionDeclaration));
+    // the start and program lines, then the spilled units moved under their program line
+    void finishParseTreeStream(SymbolInfo* start) {
+        SymbolInfo* program = start->getChildren()[0];
+        int links = program->getListLinks();
+        parseTreeWriter.setOutput(parseTreeOut);
+        parseTreeWriter.writeNode(start, 0);
+        for (int link = links - 1; link >= 0; link--) {
+            parseTreeWriter.writeListLink(program, link, links - link);
+        }
+
+        rewind(unitsOut);
+        for (int link = 0; link < links; link++) {
+            long begin = link == 0 ? 0 : unitEnds[link - 1];
+            parseTreeWriter.copyIndented(unitsOut, unitEnds[link] - begin, 1 + links - link);
         }
     }
 
-    void insertFunction(SymbolInfo * function, SymbolInfo * returnType, SymbolInfo * parameters) {
-        function->setType("FUNCTION");
-        function->setReturnType(returnType->getName());
-        function->setTypeSpecifier(returnType->getName());
-        function->setParameters(parameters->getParameters());
-        function->setFunctionDefinition(true);
+    void collect(SemanticAnalyzer& analyzer) {
+        diagnostics.insert(diagnostics.end(), analyzer.diagnostics.begin(), analyzer.diagnostics.end());
+        scopeDumps.insert(scopeDumps.end(), analyzer.dumps.begin(), analyzer.dumps.end());
+    }
 
-        bool inserted = symbolTable->insert(function);
-        if (inserted) {
-            return;
+    // global declarations of the units in order, then their function bodies in parallel,
+    // each against the global scope as it was before the function
+    void analyzeUnits(const vector<SymbolInfo*>& units) {
+        SemanticAnalyzer globalAnalyzer(symbolTable, signatureTable, dumpFile, scopeReductions);
+        vector<SymbolInfo*> functions;
+        for (auto unit : units) {
+            globalAnalyzer.declareUnit(unit);
+            SymbolInfo* declaration = unit->getChildren()[0];
+            if (declaration->getSType() == "func_definition") functions.push_back(declaration);
         }
+        collect(globalAnalyzer);
 
-        SymbolInfo* prevFunction = symbolTable->lookup(function->getName());
+        int threads = thread::hardware_concurrency();
+        if (getenv("SEMANTIC_THREADS") != NULL) threads = atoi(getenv("SEMANTIC_THREADS"));
+        threads = max(1, min(threads, (int)functions.size()));
 
-        if (!prevFunction->isFunctionDeclaration()) {
-            // prev is not a function declaration: error
-            if (!(prevFunction->isFunctionDeclaration())) {
-                yyerror(errorSymbol(function) + " redeclared as different kind of symbol");
-            }
-        } else {
-            // prev is a function declaration
-            if (prevFunction->getReturnType() != function->getReturnType()) {
-                // return type mismatch
-                yyerror("Conflicting return types for " + errorSymbol(function));
-            } else if (prevFunction->getParameters().size() != function->getParameters().size()) {
-                // no of arguments mismatch
-                yyerror("Conflicting types for " + errorSymbol(function));
-            } else {
-                // match the arguments of prev and function
-                // report error if mismatch
-                auto argumentsDeclaration = prevFunction->getParameters();
-                auto argumentsDefinition = function->getParameters();
-
-                for (int i = 0; i < argumentsDeclaration.size(); i++) {
-                    if (argumentsDeclaration[i]->getTypeSpecifier() != argumentsDefinition[i]->getTypeSpecifier()) {
-                        yyerror("Type mismatch for argument " + to_string(i + 1) + " of " + errorSymbol(function));
-                        return;
-                    }
-                }
+        vector<unique_ptr<SemanticAnalyzer>> analyzers(functions.size());
+        atomic<int> next(0);
+
+        auto worker = [&]() {
+            for (int i = next++; i < (int)functions.size(); i = next++) {
+                SymbolTable table(symbolTable->getCurrentScope(), functions[i]->getChildren()[1]->getReduction());
+                analyzers[i].reset(new SemanticAnalyzer(&table, signatureTable, dumpFile, scopeReductions));
+                analyzers[i]->checkFunction(functions[i]);
             }
-        }
+        };
+
+        vector<thread> pool;
+        for (int i = 1; i < threads; i++) pool.push_back(thread(worker));
+        worker();
+        for (auto& t : pool) t.join();
+
+        for (auto& analyzer : analyzers) collect(*analyzer);
     }
 
-    string typeCast(SymbolInfo * left, SymbolInfo * right) {
-        string leftType = left->getTypeSpecifier();
-        string rightType = right->getTypeSpecifier();
-        // if (leftType == "INT" && rightType == "FLOAT") {
-        //     yyerror("Warning: possible loss of data in assignment of FLOAT to INT");
-        // }
-        if (leftType == "error" || rightType == "error") {
-            return "error";
-        }
-        if (leftType == "FLOAT" or rightType == "FLOAT") {
-            return "FLOAT";
-        }
+    // the function definition a syntax error cut short, after every finished unit
+    void analyzeUnfinishedUnit() {
+        reverse(discardedSymbols.begin(), discardedSymbols.end());
+        auto isFunction = [](const auto& symbol) { return symbol.first->isLeaf() && symbol.first->isFunctionDefinition(); };
+        auto function = find_if(discardedSymbols.begin(), discardedSymbols.end(), isFunction);
+        if (function == discardedSymbols.end()) return;
 
-        return "INT";
+        SemanticAnalyzer analyzer(symbolTable, signatureTable, dumpFile, scopeReductions);
+        analyzer.checkUnfinishedFunction(function->first, vector<pair<SymbolInfo*, bool>>(function + 1, discardedSymbols.end()));
+        collect(analyzer);
     }
 
-    void buildParseTree(SymbolInfo* left, vector<SymbolInfo*> rights) {
-        left->setChildren(rights);
-        left->setStartLine(rights[0]->getStartLine());
+    void copyFile(FILE* from, long length, FILE* to) {
+        char buffer[1 << 16];
+        while (length > 0) {
+            size_t got = fread(buffer, 1, min(length, (long)sizeof(buffer)), from);
+            if (got == 0) break;
+            fwrite(buffer, 1, got, to);
+            length -= got;
+        }
     }
 
-    void preOrderParaseTree(SymbolInfo* head) {
-        fprintf(parseTreeOut, head->printNode().c_str());
-        for (auto child: head->getChildren()) {
-            child->setDepth(head->getDepth() + 1);
-            preOrderParaseTree(child);
+    // the errors of the units analyzed so far in source order, and the log up to now with every
+    // scope dump after its compound_statement line, the units after them have no reduction yet
+    void writeAnalysis() {
+        auto byReduction = [](const auto& a, const auto& b) { return a.reduction < b.reduction; };
+        stable_sort(diagnostics.begin(), diagnostics.end(), byReduction);
+        for (auto& diagnostic : diagnostics) {
+            errorCount++;
+            fprintf(errorout, "Line# %d: %s\n", diagnostic.line, diagnostic.message.c_str());
         }
+        diagnostics.clear();
+
+        stable_sort(scopeDumps.begin(), scopeDumps.end(), byReduction);
+        long logLength = ftell(logout);
+        fseek(logout, logCopied, SEEK_SET);
+        for (auto& dump : scopeDumps) {
+            long offset = lower_bound(dumpOffsets.begin(), dumpOffsets.end(), make_pair(dump.reduction, 0L))->second;
+            copyFile(logout, offset - logCopied, logFile);
+            logCopied = offset;
+            if (dumpFile.file != NULL) {
+                fseek(dumpFile.file, dump.offset, SEEK_SET);
+                copyFile(dumpFile.file, dump.length, logFile);
+            } else {
+                fwrite(dumpFile.memory.data() + dump.offset, 1, dump.length, logFile);
+            }
+        }
+        copyFile(logout, logLength - logCopied, logFile);
+        logCopied = logLength;
+        fseek(logout, 0, SEEK_END);
+        scopeDumps.clear();
+        dumpOffsets.clear();
+        dumpFile.clear();
+    }
+
+    void finishSemanticAnalysis() {
+        analyzeUnits(pendingUnits);
+        analyzeUnfinishedUnit();
+        writeAnalysis();
     }
 
     int yyparse(void);
@@ -142,6 +282,10 @@
 
 %right ELSE THEN  // same precedence but shift wins
 
+// not the lookahead, it is no part of the unit
+%destructor { if (&$$ != &yylval) discardedSymbols.push_back({$$, false}); } <>
+%destructor { discardedSymbols.push_back({$$, true}); } lcurl
+
 
 %%
 
@@ -151,18 +295,38 @@
         $$->setDepth(0);
         buildParseTree($$, {$1});
 
-        preOrderParaseTree($$);
+        parseTreeWriter.setOutput(parseTreeOut);
+        if (streamParseTree) {
+            finishParseTreeStream($$);
+        } else {
+            preOrderParaseTree($$, 0);
+        }
+        parseTreeWriter.flush();
     };
 
     program : program unit {
         logOutput("program", "program unit");
-        $$ = new SymbolInfo("", "program");
-        buildParseTree($$, {$1, $2});
+        $$ = $1;
+        buildList($$, {$2});
+        if (streamParseTree) {
+            analyzeUnits({$2});
+            writeAnalysis();
+            streamUnit($2);
+        } else {
+            pendingUnits.push_back($2);
+        }
     }
     | unit {
         logOutput("program", "unit");
         $$ = new SymbolInfo("", "program");
-        buildParseTree($$, {$1});
+        buildList($$, {$1});
+        if (streamParseTree) {
+            analyzeUnits({$1});
+            writeAnalysis();
+            streamUnit($1);
+        } else {
+            pendingUnits.push_back($1);
+        }
     };
 
     unit : var_declaration {
@@ -189,12 +353,9 @@
         // $2 is the function id
         $2->setFunctionDeclaration(true);
         $2->setType("FUNCTION");
-        $2->setReturnType($1->getName());
-        $2->setTypeSpecifier($1->getName());
+        $2->setReturnType($1->getTypeSpecifier());
+        $2->setTypeSpecifier($1->getTypeSpecifier());
         $2->setParameters($4->getParameters());
-
-        argumentInfo->setParameters({});
-        insertFunctionDeclaration($2);
     }
     | type_specifier ID LPAREN RPAREN SEMICOLON {
         logOutput("func_declaration", "type_specifier ID LPAREN RPAREN SEMICOLON");
@@ -202,22 +363,19 @@
         buildParseTree($$, {$1, $2, $3, $4, $5});
         $2->setFunctionDeclaration(true);
         $2->setType("FUNCTION");
-        $2->setReturnType($1->getName());
-        $2->setTypeSpecifier($1->getName());
-        argumentInfo->setParameters({});
-        insertFunctionDeclaration($2);
+        $2->setReturnType($1->getTypeSpecifier());
+        $2->setTypeSpecifier($1->getTypeSpecifier());
     };
 
     func_definition : type_specifier ID LPAREN parameter_list RPAREN {
-        insertFunction($2, $1, $4);
+        defineFunction($2, $1, $4);
     } compound_statement {
         logOutput("func_definition", "type_specifier ID LPAREN parameter_list RPAREN compound_statement");
         $$ = new SymbolInfo("", "func_definition");
         buildParseTree($$, {$1, $2, $3, $4, $5, $7});
-        // no need to update $2, it is handled in insertFunction
     }
     | type_specifier ID LPAREN RPAREN {
-        insertFunction($2, $1, new SymbolInfo("", ""));
+        defineFunction($2, $1, new SymbolInfo("", ""));
     } compound_statement {
         $$ = new SymbolInfo("", "func_definition");
         buildParseTree($$, {$1, $2, $3, $4, $6});
@@ -226,47 +384,62 @@
 
     parameter_list : parameter_list COMMA type_specifier ID {
         logOutput("parameter_list", "parameter_list COMMA type_specifier ID");
-        $$ = new SymbolInfo("", "parameter_list");
-        buildParseTree($$, {$1, $2, $3, $4});
-        $$->setParameters($1->getParameters());
+        $$ = $1;
+        buildList($$, {$2, $3, $4});
         $4->setType($3->getName());
-        $4->setTypeSpecifier($3->getName());
+        $4->setTypeSpecifier($3->getTypeSpecifier());
+        $$->pushParameter($4);
+    }
+    | parameter_list COMMA type_specifier ID LSQUARE RSQUARE {
+        logOutput("parameter_list", "parameter_list COMMA type_specifier ID LSQUARE RSQUARE");
+        $$ = $1;
+        buildList($$, {$2, $3, $4, $5, $6});
+        $4->setType($3->getName());
+        $4->setTypeSpecifier($3->getTypeSpecifier());
+        $4->setArray(true);
         $$->pushParameter($4);
-        argumentInfo->setParameters($$->getParameters());
     }
     | parameter_list COMMA type_specifier {
         logOutput("parameter_list", "parameter_list COMMA type_specifier");
-        $$ = new SymbolInfo("", "parameter_list");
-        buildParseTree($$, {$1, $2, $3});
-        $$->setParameters($1->getParameters());
-        $$->pushParameter(new SymbolInfo("", $3->getName(), $3->getName(), $3->getName()));
-        argumentInfo->setParameters($$->getParameters());
+        $$ = $1;
+        buildList($$, {$2, $3});
+        $$->pushParameter(new SymbolInfo("", $3->getName(), $3->getTypeSpecifier(), $3->getTypeSpecifier()));
     }
     | type_specifier ID {
         logOutput("parameter_list", "type_specifier ID");
         $$ = new SymbolInfo("", "parameter_list");
-        buildParseTree($$, {$1, $2});
+        buildList($$, {$1, $2});
+        $2->setType($1->getName());
+        $2->setTypeSpecifier($1->getTypeSpecifier());
+        $$->pushParameter($2);
+    }
+    | type_specifier ID LSQUARE RSQUARE {
+        logOutput("parameter_list", "type_specifier ID LSQUARE RSQUARE");
+        $$ = new SymbolInfo("", "parameter_list");
+        buildList($$, {$1, $2, $3, $4});
         $2->setType($1->getName());
-        $2->setTypeSpecifier($1->getName());
+        $2->setTypeSpecifier($1->getTypeSpecifier());
+        $2->setArray(true);
         $$->pushParameter($2);
-        argumentInfo->setParameters($$->getParameters());
     }
     | type_specifier {
         logOutput("parameter_list", "type_specifier");
         $$ = new SymbolInfo("", "parameter_list");
-        buildParseTree($$, {$1});
-        $$->pushParameter(new SymbolInfo("", $1->getName(), $1->getName(), $1->getName()));
-        argumentInfo->setParameters($$->getParameters());
+        buildList($$, {$1});
+        $$->pushParameter(new SymbolInfo("", $1->getName(), $1->getTypeSpecifier(), $1->getTypeSpecifier()));
     };
 
     compound_statement : lcurl statements RCURL {
         logOutput("compound_statement", "LCURL statements RCURL");
         $$ = new SymbolInfo("", "compound_statement");
         buildParseTree($$, {$1, $2, $3});
-        fputs(symbolTable->printAllScope().c_str(), logout);
-        symbolTable->exitScope();
+        dumpOffsets.push_back({$$->getReduction(), ftell(logout)});
     }
-    | lcurl RCURL {};
+    | lcurl RCURL {
+        // an empty block is passed on as its lcurl, which is the default value of $$
+        $$ = $1;
+        (void)$2;
+    };
 
     var_declaration : type_specifier declaration_list SEMICOLON {
         logOutput("var_declaration", "type_specifier declaration_list SEMICOLON");
@@ -275,53 +448,50 @@
 
         for (auto symbolInfo : $2->getDeclarations()) {
             symbolInfo->setType($1->getName());
-            insertToSymbolTable(symbolInfo);
         }
     };
 
     type_specifier : INT {
         logOutput("type_specifier", "INT");
-        $$ = new SymbolInfo("INT", "type_specifier", "INT");
+        $$ = new SymbolInfo("INT", "type_specifier", TYPE_INT);
         buildParseTree($$, {$1});
     }
     | FLOAT {
         logOutput("type_specifier", "FLOAT");
-        $$ = new SymbolInfo("FLOAT", "type_specifier", "FLOAT");
+        $$ = new SymbolInfo("FLOAT", "type_specifier", TYPE_FLOAT);
         buildParseTree($$, {$1});
     }
     | VOID {
         logOutput("type_specifier", "VOID");
-        $$ = new SymbolInfo("VOID", "type_specifier", "DOUBLE");
+        $$ = new SymbolInfo("VOID", "type_specifier", TYPE_VOID);
         buildParseTree($$, {$1});
     };
 
     declaration_list : declaration_list COMMA ID {
         // a, b, | c
         logOutput("declaration_list", "declaration_list COMMA ID");
-        $$ = new SymbolInfo("", "declaration_list");
-        buildParseTree($$, {$1, $2, $3});
-        $$->setDeclarations($1->getDeclarations());
+        $$ = $1;
+        buildList($$, {$2, $3});
         $$->pushDeclaration($3);
     }
     | declaration_list COMMA ID LSQUARE CONST_INT RSQUARE {
         // a, b, | c[8]
         logOutput("declaration_list", "declaration_list COMMA ID LSQUARE CONST_INT RSQUARE");
-        $$ = new SymbolInfo("", "declaration_list");
-        buildParseTree($$, {$1, $2, $3, $4, $5, $6});
-        $$->setDeclarations($1->getDeclarations());
+        $$ = $1;
+        buildList($$, {$2, $3, $4, $5, $6});
         $3->setArray(true);
         $$->pushDeclaration($3);
     }
     | ID {
         logOutput("declaration_list", "ID");
         $$ = new SymbolInfo("", "declaration_list");
-        buildParseTree($$, {$1});
+        buildList($$, {$1});
         $$->pushDeclaration($1);
     }
     | ID LSQUARE CONST_INT RSQUARE {
         logOutput("declaration_list", "ID LSQUARE CONST_INT RSQUARE");
         $$ = new SymbolInfo("", "declaration_list");
-        buildParseTree($$, {$1, $2, $3, $4});
+        buildList($$, {$1, $2, $3, $4});
         $1->setArray(true);
         $$->pushDeclaration($1);
     };
@@ -329,12 +499,12 @@
     statements : statement {
         logOutput("statements", "statement");
         $$ = new SymbolInfo("", "statements");
-        buildParseTree($$, {$1});
+        buildList($$, {$1});
     }
     | statements statement {
         logOutput("statements", "statements statement");
-        $$ = new SymbolInfo("", "statements");
-        buildParseTree($$, {$1, $2});
+        $$ = $1;
+        buildList($$, {$2});
     };
 
     statement : var_declaration {
@@ -377,10 +547,6 @@
         logOutput("statement", "PRINTLN LPAREN ID RPAREN SEMICOLON");
         $$ = new SymbolInfo("", "statement");
         buildParseTree($$, {$1, $2, $3, $4, $5});
-
-        if (!symbolTable->lookup($3->getName())) {
-            yyerror("Undeclared variable " + errorSymbol($3));
-        }
     }
     | RETURN expression SEMICOLON {
         logOutput("statement", "RETURN expression SEMICOLON");
@@ -396,7 +562,6 @@
     | expression SEMICOLON {
         logOutput("expression_statement", "expression SEMICOLON");
         $$ = new SymbolInfo("", "expression_statement");
-        $$->setTypeSpecifier($1->getTypeSpecifier());
         buildParseTree($$, {$1, $2});
     };
 
@@ -404,178 +569,88 @@
         logOutput("variable", "ID");
         $$ = new SymbolInfo("", "variable");
         buildParseTree($$, {$1});
-
-        SymbolInfo* search = symbolTable->lookup($1->getName());
-
-        if (search == nullptr) {
-            yyerror("Undeclared variable " + errorSymbol($1));
-            $$->setTypeSpecifier("error");
-        } else if (search->isArray()) {
-            $$->setTypeSpecifier(search->getTypeSpecifier());
-            $$->setArray(search->isArray());
-        } else {
-            $$->setTypeSpecifier(search->getTypeSpecifier());
-            $$->setArray(search->isArray());
-        }
     }
     | ID LSQUARE expression RSQUARE {
         logOutput("variable", "ID LSQUARE expression RSQUARE");
         $$ = new SymbolInfo("", "variable");
         buildParseTree($$, {$1, $2, $3, $4});
-
-        SymbolInfo* search = symbolTable->lookup($1->getName());
-
-        if (search == nullptr) {
-            yyerror("Undeclared variable " + errorSymbol($1));
-        } else if (!search->isArray()) {
-            yyerror(errorSymbol($1) + " is not an array");
-            $$->setTypeSpecifier(search->getTypeSpecifier());
-        } else {
-            $$->setTypeSpecifier(search->getTypeSpecifier());
-        }
-        if ($3->getTypeSpecifier() != "INT") {
-            yyerror("Array subscript is not an integer");
-        }
     };
-    // TODO: upto this typespecifier of expression done
+
     expression : logic_expression {
         logOutput("expression", "logic_expression");
-        $$ = new SymbolInfo("", "expression", $1->getTypeSpecifier());
+        $$ = new SymbolInfo("", "expression");
         buildParseTree($$, {$1});
-        $$->setTypeSpecifier($1->getTypeSpecifier());
     }
     | variable ASSIGNOP logic_expression {
         logOutput("expression", "variable ASSIGNOP logic_expression");
         $$ = new SymbolInfo("", "expression");
         buildParseTree($$, {$1, $2, $3});
-        $$->setTypeSpecifier($1->getTypeSpecifier());
-
-        if ($1->getTypeSpecifier() == "INT" && $3->getTypeSpecifier() == "FLOAT") {
-            yyerror("Warning: possible loss of data in assignment of FLOAT to INT");
-        }
-
-        if ($3->getTypeSpecifier() == "VOID") {
-            yyerror("Void function cannot be used in expression");
-        } else if ($1->getTypeSpecifier() == "FLOAT" && $3->getTypeSpecifier() == "INT") {
-            // auto cast
-        } else if ($1->getTypeSpecifier() != $3->getTypeSpecifier() && $1->getTypeSpecifier() != "error" && $3->getTypeSpecifier() == "error") {
-            // FIXME: 
-            // yyerror("Type mismatch");
-        }
     };
 
     logic_expression : rel_expression {
         logOutput("logic_expression", "rel_expression");
         $$ = new SymbolInfo("", "logic_expression");
         buildParseTree($$, {$1});
-        $$->setArray($1->isArray());
-        $$->setTypeSpecifier($1->getTypeSpecifier());
     }
     | rel_expression LOGICOP rel_expression {
         logOutput("logic_expression", "rel_expression LOGICOP rel_expression");
         $$ = new SymbolInfo("", "logic_expression");
         buildParseTree($$, {$1, $2, $3});
-        $$->setTypeSpecifier("INT");
     };
 
     rel_expression : simple_expression {
         logOutput("rel_expression", "simple_expression");
         $$ = new SymbolInfo("", "rel_expression");
         buildParseTree($$, {$1});
-        $$->setTypeSpecifier($1->getTypeSpecifier());
-        $$->setArray($1->isArray());
     }
     | simple_expression RELOP simple_expression {
         logOutput("rel_expression", "simple_expression RELOP simple_expression");
         $$ = new SymbolInfo("", "rel_expression");
         buildParseTree($$, {$1, $2, $3});
-        if ($1->getTypeSpecifier() == "VOID" or $3->getTypeSpecifier() == "VOID") {
-            yyerror("Void cannot be used in expression");
-            $$->setTypeSpecifier("error");
-        } else {
-            $$->setTypeSpecifier("INT");
-        }
     };
 
     simple_expression : term {
         logOutput("simple_expression", "term");
         $$ = new SymbolInfo("", "simple_expression");
         buildParseTree($$, {$1});
-        $$->setTypeSpecifier($1->getTypeSpecifier());
-        $$->setArray($1->isArray());
     }
     | simple_expression ADDOP term {
         logOutput("simple_expression", "simple_expression ADDOP term");
         $$ = new SymbolInfo("", "simple_expression");
         buildParseTree($$, {$1, $2, $3});
-        $$->setTypeSpecifier(typeCast($1, $3));
-        if ($3->getTypeSpecifier() == "VOID") {
-            yyerror("Void cannot be used in expression");
-        }
     };
 
     term : unary_expression {
         logOutput("term", "unary_expression");
         $$ = new SymbolInfo("", "term");
         buildParseTree($$, {$1});
-        $$->setTypeSpecifier($1->getTypeSpecifier());
-        $$->setArray($1->isArray());
     }
     | term MULOP unary_expression {
         logOutput("term", "term MULOP unary_expression");
         $$ = new SymbolInfo("", "term");
         buildParseTree($$, {$1, $2, $3});
-        $$->setTypeSpecifier(typeCast($1, $3));
-
-        if ($3->getTypeSpecifier() == "VOID") {
-            yyerror("Void cannot be used in expression");
-        } else if ($2->getName() == "%" and $3->getName() == "0") {
-            yyerror("Warning: division by zero");
-            $$->setTypeSpecifier("error");
-        }
-        else if($2->getName() == "%" && ( $1->getTypeSpecifier() != "INT" || $3->getTypeSpecifier() != "INT") ){
-        	yyerror("Operands of modulus must be integers ");
-        	$$->setTypeSpecifier("error");
-        }
     };
 
     unary_expression : ADDOP unary_expression {
         logOutput("unary_expression", "ADDOP unary_expression");
         $$ = new SymbolInfo("", "unary_expression");
         buildParseTree($$, {$1, $2});
-        if ($2->getTypeSpecifier() == "VOID" ){
-			yyerror("Void cannot be used in expression");
-			$$->setTypeSpecifier("error");
-		} else{
-			$$->setTypeSpecifier($2->getTypeSpecifier());
-		}
     }
     | NOT unary_expression {
         logOutput("unary_expression", "NOT unary_expression");
         $$ = new SymbolInfo("", "unary_expression");
         buildParseTree($$, {$1, $2});
-
-        if ($2->getTypeSpecifier() == "VOID") {
-            yyerror("Void cannot be used in expression");
-            $$->setTypeSpecifier("error");
-        } else {
-            $$->setTypeSpecifier("INT");
-        }
     }
     | factor {
         logOutput("unary_expression", "factor");
         $$ = new SymbolInfo($1->getName(), "unary_expression");
         buildParseTree($$, {$1});
-        $$->setTypeSpecifier($1->getTypeSpecifier());
-        $$->setArray($1->isArray());
     };
 
     factor : variable {
         logOutput("factor", "variable");
         $$ = new SymbolInfo("", "factor");
         buildParseTree($$, {$1});
-        $$->setTypeSpecifier($1->getTypeSpecifier());
-        $$->setArray($1->isArray());
     }
     | ID LPAREN argument_list RPAREN {
         // function call
@@ -583,74 +658,31 @@
         logOutput("factor", "ID LPAREN argument_list RPAREN");
         $$ = new SymbolInfo("", "factor");
         buildParseTree($$, {$1, $2, $3, $4});
-
-        SymbolInfo* search = symbolTable->lookup($1->getName());
-        
-        if (search == nullptr) {
-            yyerror("Undeclared function " + errorSymbol($1));
-        } else {
-            auto argumentsDeclaration = search->getParameters();
-            auto argumentsCall = $3->getParameters();
-
-            $$->setTypeSpecifier(search->getTypeSpecifier());
-            if (!search->isFunctionDeclaration() && !search->isFunctionDefinition()) {
-                yyerror(errorSymbol($1) + " is not a function");
-            } else if (argumentsDeclaration.size() > argumentsCall.size()) {
-                yyerror("Too few arguments to function " + errorSymbol($1));
-            } else if (argumentsDeclaration.size() < argumentsCall.size()) {
-                yyerror("Too many arguments to function " + errorSymbol($1));
-            } else {
-
-                for (int i = 0; i < argumentsDeclaration.size(); i++) {
-                    if (argumentsDeclaration[i]->getTypeSpecifier() != argumentsCall[i]->getTypeSpecifier()) {
-                        yyerror("Type mismatch for argument " + to_string(i + 1) + " of " + errorSymbol(search));
-                    }
-                    if (argumentsDeclaration[i]->isArray() != argumentsCall[i]->isArray()) {
-                        yyerror("Type mismatch (array) for argument" + to_string(i + 1) + " of " + errorSymbol(search));
-                    }
-                }
-            }
-        }
     }
     | LPAREN expression RPAREN {
         logOutput("factor", "LPAREN expression RPAREN");
         $$ = new SymbolInfo("", "factor");
         buildParseTree($$, {$1, $2, $3});
-        $$->setTypeSpecifier($2->getTypeSpecifier());
     }
     | CONST_INT {
         logOutput("factor", "CONST_INT");
         $$ = new SymbolInfo($1->getName(), "factor");
         buildParseTree($$, {$1});
-        $$->setTypeSpecifier("INT");
     }
     | CONST_FLOAT {
         logOutput("factor", "CONST_FLOAT");
         $$ = new SymbolInfo($1->getName(), "factor");
         buildParseTree($$, {$1});
-        $$->setTypeSpecifier("FLOAT");
     }
     | variable INCOP {
         logOutput("factor", "INCOP");
         $$ = new SymbolInfo("", "factor");
         buildParseTree($$, {$1, $2});
-        if ($1->getTypeSpecifier() == "VOID") {
-            yyerror("Void function is used in expression");
-            $$->setTypeSpecifier("error");
-        } else {
-            $$->setTypeSpecifier($1->getTypeSpecifier());
-        }
     }
     | variable DECOP {
         logOutput("factor", "DECOP");
         $$ = new SymbolInfo("", "factor");
         buildParseTree($$, {$1, $2});
-        if ($1->getTypeSpecifier() == "VOID") {
-            yyerror("Void function is used in expression");
-            $$->setTypeSpecifier("error");
-        } else {
-            $$->setTypeSpecifier($1->getTypeSpecifier());
-        }
     };
 
     argument_list : arguments {
@@ -659,33 +691,33 @@
         buildParseTree($$, {$1});
         $$->setParameters($1->getParameters());
     }
-    | { /*for void function call*/ };
+    | {
+        /*for void function call*/
+        // a node of its own, not the stale value left on the parser stack
+        $$ = new SymbolInfo("", "argument_list");
+        $$->setStartLine(yylineno);
+        $$->setEndLine(yylineno);
+        $$->setReduction(++reductionCount, yylineno);
+    };
 
     arguments : arguments COMMA logic_expression {
         logOutput("arguments", "arguments COMMA logic_expression");
-        $$ = new SymbolInfo("", "arguments");
-        buildParseTree($$, {$1, $2, $3});
-        $$->setParameters($1->getParameters());
+        $$ = $1;
+        buildList($$, {$2, $3});
         $$->pushParameter($3);
     }
     | logic_expression {
         logOutput("arguments", "logic_expression");
         $$ = new SymbolInfo("", "arguments");
-        buildParseTree($$, {$1});
+        buildList($$, {$1});
         $$->pushParameter($1);
     };
 
     lcurl : LCURL {
-        symbolTable->enterScope();
+        // the scope is entered by the semantic pass, the lcurls are counted for its id
         $$ = $1;
-        // insert arguments with names
-        for (auto argument: argumentInfo->getParameters()) {
-            if (argument->getName() == "") continue;
-            if (argument->getTypeSpecifier() == "VOID")
-                argument->setTypeSpecifier("error");
-            insertToSymbolTable(argument, "Redefinition of parameter ");
-        }
-        argumentInfo->setParameters({});
+        $$->setReduction(++reductionCount, yylineno);
+        scopeReductions.push_back(reductionCount);
     }
 
 %%
@@ -696,17 +728,24 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
-    logout = fopen("1905018_log.txt", "w");
+    logout = tmpfile();
+    logFile = fopen("1905018_log.txt", "w");
     errorout = fopen("1905018_error.txt", "w");
     parseTreeOut = fopen("1905018_parseTree.txt", "w");
 
+    const char* stream = getenv("PARSE_TREE_STREAM");
+    streamParseTree = stream != NULL && strcmp(stream, "1") == 0;
+    if (streamParseTree && (unitsOut = tmpfile()) == NULL) streamParseTree = false;
+
     yyin = fp;
     yyparse();
+    finishSemanticAnalysis();
 
-    fprintf(logout, "Total Lines: %d\nTotal Errors: %d\n", yylineno, errorCount);
+    fprintf(logFile, "Total Lines: %d\nTotal Errors: %d\n", yylineno, errorCount);
 
     fclose(yyin);
     fclose(logout);
+    fclose(logFile);
     fclose(errorout);
 
     return 0;
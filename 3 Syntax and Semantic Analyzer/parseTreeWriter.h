@@ -0,0 +1,124 @@
+#ifndef PARSE_TREE_WRITER
+#define PARSE_TREE_WRITER
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "symbolInfo.h"
+
+using namespace std;
+
+// buffered writer of parse tree lines
+// indentation is copied out of one string of spaces instead of being built per line
+class ParseTreeWriter {
+    FILE* out = nullptr;
+    char buffer[1 << 16];
+    size_t used = 0;
+    string spaces;
+
+   public:
+    ~ParseTreeWriter() { flush(); }
+
+    void setOutput(FILE* out) {
+        flush();
+        this->out = out;
+    }
+
+    void flush() {
+        if (used > 0 && out != nullptr) fwrite(buffer, 1, used, out);
+        used = 0;
+    }
+
+    void write(const char* s, size_t length) {
+        if (used + length > sizeof(buffer)) {
+            flush();
+            if (length > sizeof(buffer)) {
+                fwrite(s, 1, length, out);
+                return;
+            }
+        }
+        memcpy(buffer + used, s, length);
+        used += length;
+    }
+    void write(const string& s) { write(s.data(), s.size()); }
+    void write(int n) {
+        char digits[16];
+        write(digits, snprintf(digits, sizeof(digits), "%d", n));
+    }
+
+    void indent(int depth) {
+        if ((int)spaces.size() < depth) spaces.resize(max(depth, 2 * (int)spaces.size()), ' ');
+        write(spaces.data(), depth);
+    }
+
+    // same line as SymbolInfo::printNode
+    void writeNode(SymbolInfo* node, int depth) {
+        indent(depth);
+        write(node->getSType());
+        write(" :", 2);
+        if (node->isLeaf()) {
+            write(" ", 1);
+            write(node->getName());
+        }
+        for (auto child : node->getChildren()) {
+            write(" ", 1);
+            write(child->getSType());
+        }
+
+        if (node->isLeaf()) {
+            write("\t<Line: ", 8);
+            write(node->getStartLine());
+        } else {
+            write(" \t<Line: ", 9);
+            write(node->getStartLine());
+            write("-", 1);
+            write(node->getEndLine());
+        }
+        write(">\n", 2);
+    }
+
+    // the line the nested node of the link-th reduction of a list node prints
+    void writeListLink(SymbolInfo* node, int link, int depth) {
+        indent(depth);
+        write(node->getSType());
+        write(" :", 2);
+        if (link > 0) {
+            write(" ", 1);
+            write(node->getSType());
+        }
+        auto& children = node->getChildren();
+        for (int i = node->getListLinkBegin(link); i < node->getListLinkEnd(link); i++) {
+            write(" ", 1);
+            write(children[i]->getSType());
+        }
+        write(" \t<Line: ", 9);
+        write(node->getStartLine());
+        write("-", 1);
+        write(node->getListLinkEndLine(link));
+        write(">\n", 2);
+    }
+
+    // copies length bytes of in, every line indented by depth more spaces
+    void copyIndented(FILE* in, long length, int depth) {
+        char chunk[1 << 16];
+        bool lineStart = true;
+        while (length > 0) {
+            size_t read = fread(chunk, 1, min(length, (long)sizeof(chunk)), in);
+            if (read == 0) break;
+            length -= read;
+
+            for (char *c = chunk, *end = chunk + read; c < end;) {
+                if (lineStart) indent(depth);
+                char* newline = (char*)memchr(c, '\n', end - c);
+                char* stop = newline != nullptr ? newline + 1 : end;
+                write(c, stop - c);
+                lineStart = newline != nullptr;
+                c = stop;
+            }
+        }
+    }
+};
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef SCOPE_TABLE
 #define SCOPE_TABLE
 
+#include <climits>
+
 #include "symbolInfo.h"
 using namespace std;
 
@@ -101,12 +103,13 @@ class ScopeTable {
         return this->insert(info);
     }
 
-    SymbolInfo* lookup(string name) {
+    // symbols declared after the reduction visibleUntil are not there yet
+    SymbolInfo* lookup(string name, int visibleUntil = INT_MAX) {
         unsigned int hashValue = hashFunction(name);
         int position = 1;
         SymbolInfo* symbolInfo = scopeTable[hashValue];
 
-        while (symbolInfo != nullptr) {
+        while (symbolInfo != nullptr && symbolInfo->getReduction() <= visibleUntil) {
             if (symbolInfo->getName() == name) {
                 // cout << "\t'" << name << "' found in ScopeTable# " << id << " at position " << (hashValue + 1) << ", " << position << endl;
                 return symbolInfo;
@@ -150,17 +153,18 @@ class ScopeTable {
         return false;
     }
 
-    string print() {
+    // a chain is in the order of insertion, so the hidden symbols are at its tail
+    string print(int visibleUntil = INT_MAX) {
         string ret = "\tScopeTable# " + to_string(id) + "\n";
 
         for (int i = 0; i < N; i++) {
             SymbolInfo* symbolInfo = scopeTable[i];
             bool notNull = false;
-            if (symbolInfo != nullptr) {
+            if (symbolInfo != nullptr && symbolInfo->getReduction() <= visibleUntil) {
                 ret += ("\t" + to_string(i + 1) + "--> ");
                 notNull = true;
             }
-            while (symbolInfo != nullptr) {
+            while (symbolInfo != nullptr && symbolInfo->getReduction() <= visibleUntil) {
                 ret += symbolInfo->print();
                 symbolInfo = symbolInfo->getNext();
             }
@@ -0,0 +1,428 @@
+#ifndef SEMANTIC_ANALYZER
+#define SEMANTIC_ANALYZER
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "signatureTable.h"
+#include "symbolInfo.h"
+#include "symbolTable.h"
+
+// semantic checks over the parse tree, run after parsing instead of inside the grammar actions
+// declareUnit fills the global scope unit by unit in source order, then checkFunction checks a
+// function body against it on its own, so bodies can be checked in parallel
+// every diagnostic and scope dump carries the reduction it belongs to,
+// sorted by it they come out as the parser would have reported them
+
+using namespace std;
+
+struct Diagnostic {
+    int reduction;
+    int line;
+    string message;
+};
+
+// the scopes printed to the log after the compound statement of this reduction,
+// the text is at offset in the dump file (or in its memory)
+struct ScopeDump {
+    int reduction;
+    long offset;
+    long length;
+};
+
+// a dump holds every scope down to the global one, so the texts go to a spill file shared
+// by the workers as soon as they are printed instead of staying in memory until the log is written
+class DumpFile {
+   private:
+    mutex lock;
+    long end = 0;
+
+   public:
+    // the dumps stay in memory when no temporary file can be made
+    FILE* file = tmpfile();
+    string memory;
+
+    ~DumpFile() {
+        if (file != NULL) fclose(file);
+    }
+
+    ScopeDump write(int reduction, const string& text) {
+        lock_guard<mutex> guard(lock);
+        if (file != NULL) {
+            fseek(file, end, SEEK_SET);
+            fwrite(text.data(), 1, text.size(), file);
+        } else {
+            memory.resize(end);
+            memory += text;
+        }
+        end += text.size();
+        return {reduction, end - (long)text.size(), (long)text.size()};
+    }
+
+    // once every dump is in the log the file is written over from the start
+    void clear() {
+        end = 0;
+    }
+};
+
+class SemanticAnalyzer {
+   private:
+    SymbolTable* table;
+    // phase one interns the signatures of the functions, the bodies only look them up
+    SignatureTable& signatures;
+    DumpFile& dumpFile;
+    // reductions of every lcurl in order, the n-th opens ScopeTable# n + 2
+    const vector<int>& scopeReductions;
+
+    string errorSymbol(SymbolInfo* info) {
+        return ("'" + info->getName() + "'");
+    }
+
+    void error(SymbolInfo* at, string message) {
+        diagnostics.push_back({at->getReduction(), at->getReductionLine(), message});
+    }
+
+    void insertToSymbolTable(SymbolInfo* symbolInfo, SymbolInfo* at, string errorText = "Conflicting types for ") {
+        // handle void variable
+        if (symbolInfo->getTypeSpecifier() == TYPE_VOID) {
+            error(at, "Variable or field " + errorSymbol(symbolInfo) + " declared void");
+            return;
+        }
+
+        symbolInfo->setReduction(at->getReduction(), at->getReductionLine());
+        bool inserted = table->insert(symbolInfo);
+        if (!inserted) {
+            error(at, errorText + errorSymbol(symbolInfo));
+        }
+    }
+
+    void declareVariables(SymbolInfo* varDeclaration) {
+        for (auto symbolInfo : varDeclaration->getChildren()[1]->getDeclarations()) {
+            insertToSymbolTable(symbolInfo, varDeclaration);
+        }
+    }
+
+    void insertFunctionDeclaration(SymbolInfo* funcDeclaration) {
+        SymbolInfo* function = funcDeclaration->getChildren()[1];
+        function->setReduction(funcDeclaration->getReduction(), funcDeclaration->getReductionLine());
+        function->setSignature(signatures.intern(signatureOf(function->getReturnType(), function->getParameters())));
+        bool inserted = table->insert(function);
+
+        if (!inserted) {
+            error(funcDeclaration, "Multiple declaration of " + errorSymbol(function));
+        }
+    }
+
+    // the function id carries the reduction of the mid-rule action before the body
+    void insertFunction(SymbolInfo* function) {
+        bool inserted = table->insert(function);
+        if (inserted) {
+            return;
+        }
+
+        SymbolInfo* prevFunction = table->lookup(function->getName());
+
+        if (!prevFunction->isFunctionDeclaration()) {
+            // prev is not a function declaration: error
+            error(function, errorSymbol(function) + " redeclared as different kind of symbol");
+        } else if (signatures.intern(signatureOf(function->getReturnType(), function->getParameters())) != prevFunction->getSignature()) {
+            // prev is a function declaration with another signature, find what differs
+            if (prevFunction->getReturnType() != function->getReturnType()) {
+                // return type mismatch
+                error(function, "Conflicting return types for " + errorSymbol(function));
+            } else if (prevFunction->getParameters().size() != function->getParameters().size()) {
+                // no of arguments mismatch
+                error(function, "Conflicting types for " + errorSymbol(function));
+            } else {
+                // match the arguments of prev and function
+                // report error if mismatch
+                auto& argumentsDeclaration = prevFunction->getParameters();
+                auto& argumentsDefinition = function->getParameters();
+
+                for (size_t i = 0; i < argumentsDeclaration.size(); i++) {
+                    if (argumentsDeclaration[i]->getTypeSpecifier() != argumentsDefinition[i]->getTypeSpecifier()) {
+                        error(function, "Type mismatch for argument " + to_string(i + 1) + " of " + errorSymbol(function));
+                        return;
+                    }
+                    if (argumentsDeclaration[i]->isArray() != argumentsDefinition[i]->isArray()) {
+                        error(function, "Type mismatch (array) for argument " + to_string(i + 1) + " of " + errorSymbol(function));
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    void declareFunction(SymbolInfo* function) {
+        insertFunction(function);
+        // the body sees void parameters as errors, and calls see the parameters as the body does
+        for (auto parameter : function->getParameters()) {
+            if (parameter->getName() != "" && parameter->getTypeSpecifier() == TYPE_VOID) {
+                parameter->setTypeSpecifier(TYPE_ERROR);
+            }
+        }
+        function->setSignature(signatures.intern(signatureOf(function->getReturnType(), function->getParameters())));
+    }
+
+    TypeKind typeCast(SymbolInfo* left, SymbolInfo* right) {
+        TypeKind leftType = left->getTypeSpecifier();
+        TypeKind rightType = right->getTypeSpecifier();
+        if (leftType == TYPE_ERROR || rightType == TYPE_ERROR) {
+            return TYPE_ERROR;
+        }
+        if (leftType == TYPE_FLOAT or rightType == TYPE_FLOAT) {
+            return TYPE_FLOAT;
+        }
+
+        return TYPE_INT;
+    }
+
+    // opens the scope of a block, the body of a function gets the named parameters
+    void enterBlock(SymbolInfo* lcurl, vector<SymbolInfo*>& parameters) {
+        int scope = lower_bound(scopeReductions.begin(), scopeReductions.end(), lcurl->getReduction()) - scopeReductions.begin();
+        table->enterScope(scope + 2);
+        for (auto parameter : parameters) {
+            if (parameter->getName() == "") continue;
+            insertToSymbolTable(parameter, lcurl, "Redefinition of parameter ");
+        }
+        parameters.clear();
+    }
+
+    // the checks of a node, after those of its children
+    void check(SymbolInfo* node) {
+        const string& sType = node->getSType();
+        auto& children = node->getChildren();
+
+        if (sType == "compound_statement") {
+            dumps.push_back(dumpFile.write(node->getReduction(), table->printAllScope()));
+            table->exitScope();
+        } else if (sType == "var_declaration") {
+            declareVariables(node);
+        } else if (sType == "statement") {
+            if (children[0]->getSType() == "PRINTLN" && !table->lookup(children[2]->getName())) {
+                error(node, "Undeclared variable " + errorSymbol(children[2]));
+            }
+        } else if (sType == "expression_statement") {
+            if (children.size() == 2) node->setTypeSpecifier(children[0]->getTypeSpecifier());
+        } else if (sType == "variable") {
+            SymbolInfo* search = table->lookup(children[0]->getName());
+            if (children.size() == 1) {
+                if (search == nullptr) {
+                    error(node, "Undeclared variable " + errorSymbol(children[0]));
+                    node->setTypeSpecifier(TYPE_ERROR);
+                } else {
+                    node->setTypeSpecifier(search->getTypeSpecifier());
+                    node->setArray(search->isArray());
+                }
+                return;
+            }
+
+            if (search == nullptr) {
+                error(node, "Undeclared variable " + errorSymbol(children[0]));
+            } else if (!search->isArray()) {
+                error(node, errorSymbol(children[0]) + " is not an array");
+                node->setTypeSpecifier(search->getTypeSpecifier());
+            } else {
+                node->setTypeSpecifier(search->getTypeSpecifier());
+            }
+            if (children[2]->getTypeSpecifier() != TYPE_INT) {
+                error(node, "Array subscript is not an integer");
+            }
+        } else if (sType == "expression") {
+            if (children.size() == 1) {
+                node->setTypeSpecifier(children[0]->getTypeSpecifier());
+                return;
+            }
+
+            TypeKind left = children[0]->getTypeSpecifier(), right = children[2]->getTypeSpecifier();
+            node->setTypeSpecifier(left);
+            if (left == TYPE_INT && right == TYPE_FLOAT) {
+                error(node, "Warning: possible loss of data in assignment of FLOAT to INT");
+            }
+            if (right == TYPE_VOID) {
+                error(node, "Void function cannot be used in expression");
+            }
+        } else if (sType == "logic_expression" || sType == "rel_expression" || sType == "simple_expression" || sType == "term" || sType == "unary_expression") {
+            if (children.size() == 1) {
+                node->setTypeSpecifier(children[0]->getTypeSpecifier());
+                node->setArray(children[0]->isArray());
+            } else if (sType == "logic_expression") {
+                node->setTypeSpecifier(TYPE_INT);
+            } else if (sType == "rel_expression") {
+                if (children[0]->getTypeSpecifier() == TYPE_VOID or children[2]->getTypeSpecifier() == TYPE_VOID) {
+                    error(node, "Void cannot be used in expression");
+                    node->setTypeSpecifier(TYPE_ERROR);
+                } else {
+                    node->setTypeSpecifier(TYPE_INT);
+                }
+            } else if (sType == "simple_expression") {
+                node->setTypeSpecifier(typeCast(children[0], children[2]));
+                if (children[2]->getTypeSpecifier() == TYPE_VOID) {
+                    error(node, "Void cannot be used in expression");
+                }
+            } else if (sType == "term") {
+                node->setTypeSpecifier(typeCast(children[0], children[2]));
+                if (children[2]->getTypeSpecifier() == TYPE_VOID) {
+                    error(node, "Void cannot be used in expression");
+                } else if (children[1]->getName() == "%" and children[2]->getName() == "0") {
+                    error(node, "Warning: division by zero");
+                    node->setTypeSpecifier(TYPE_ERROR);
+                } else if (children[1]->getName() == "%" && (children[0]->getTypeSpecifier() != TYPE_INT || children[2]->getTypeSpecifier() != TYPE_INT)) {
+                    error(node, "Operands of modulus must be integers ");
+                    node->setTypeSpecifier(TYPE_ERROR);
+                }
+            } else {
+                // ADDOP or NOT unary_expression
+                if (children[1]->getTypeSpecifier() == TYPE_VOID) {
+                    error(node, "Void cannot be used in expression");
+                    node->setTypeSpecifier(TYPE_ERROR);
+                } else {
+                    node->setTypeSpecifier(children[0]->getSType() == "NOT" ? TYPE_INT : children[1]->getTypeSpecifier());
+                }
+            }
+        } else if (sType == "factor") {
+            checkFactor(node);
+        }
+    }
+
+    void checkFactor(SymbolInfo* node) {
+        auto& children = node->getChildren();
+        const string& first = children[0]->getSType();
+
+        if (first == "CONST_INT") {
+            node->setTypeSpecifier(TYPE_INT);
+        } else if (first == "CONST_FLOAT") {
+            node->setTypeSpecifier(TYPE_FLOAT);
+        } else if (first == "LPAREN") {
+            node->setTypeSpecifier(children[1]->getTypeSpecifier());
+        } else if (first == "variable" && children.size() == 1) {
+            node->setTypeSpecifier(children[0]->getTypeSpecifier());
+            node->setArray(children[0]->isArray());
+        } else if (first == "variable") {
+            // INCOP or DECOP
+            if (children[0]->getTypeSpecifier() == TYPE_VOID) {
+                error(node, "Void function is used in expression");
+                node->setTypeSpecifier(TYPE_ERROR);
+            } else {
+                node->setTypeSpecifier(children[0]->getTypeSpecifier());
+            }
+        } else {
+            // function call
+            SymbolInfo* search = table->lookup(children[0]->getName());
+
+            if (search == nullptr) {
+                error(node, "Undeclared function " + errorSymbol(children[0]));
+                return;
+            }
+
+            auto& argumentsDeclaration = search->getParameters();
+            auto& argumentsCall = children[2]->getParameters();
+
+            node->setTypeSpecifier(search->getTypeSpecifier());
+            if (!search->isFunctionDeclaration() && !search->isFunctionDefinition()) {
+                error(node, errorSymbol(children[0]) + " is not a function");
+            } else if (signatures.find(signatureOf(search->getReturnType(), argumentsCall)) == search->getSignature()) {
+                // the arguments match the parameters
+            } else if (argumentsDeclaration.size() > argumentsCall.size()) {
+                error(node, "Too few arguments to function " + errorSymbol(children[0]));
+            } else if (argumentsDeclaration.size() < argumentsCall.size()) {
+                error(node, "Too many arguments to function " + errorSymbol(children[0]));
+            } else {
+                for (size_t i = 0; i < argumentsDeclaration.size(); i++) {
+                    if (argumentsDeclaration[i]->getTypeSpecifier() != argumentsCall[i]->getTypeSpecifier()) {
+                        error(node, "Type mismatch for argument " + to_string(i + 1) + " of " + errorSymbol(search));
+                    }
+                    if (argumentsDeclaration[i]->isArray() != argumentsCall[i]->isArray()) {
+                        error(node, "Type mismatch (array) for argument" + to_string(i + 1) + " of " + errorSymbol(search));
+                    }
+                }
+            }
+        }
+    }
+
+    // the nodes of a subtree of a body, visited with an explicit stack in the order the parser reduced them
+    void checkTree(SymbolInfo* root, vector<SymbolInfo*>& parameters) {
+        vector<pair<SymbolInfo*, bool>> stack = {{root, false}};
+
+        while (!stack.empty()) {
+            SymbolInfo* node = stack.back().first;
+            bool childrenDone = stack.back().second;
+            stack.pop_back();
+
+            if (childrenDone) {
+                check(node);
+                continue;
+            }
+
+            // an empty block is its LCURL alone
+            if (node->isLeaf()) {
+                enterBlock(node, parameters);
+                table->exitScope();
+                continue;
+            }
+            if (node->getSType() == "compound_statement") enterBlock(node->getChildren()[0], parameters);
+
+            stack.push_back({node, true});
+            auto& children = node->getChildren();
+            for (auto it = children.rbegin(); it != children.rend(); it++) {
+                SymbolInfo* child = *it;
+                if (!child->isLeaf() || (child->getSType() == "LCURL" && node->getSType() != "compound_statement")) {
+                    stack.push_back({child, false});
+                }
+            }
+        }
+    }
+
+   public:
+    vector<Diagnostic> diagnostics;
+    vector<ScopeDump> dumps;
+
+    SemanticAnalyzer(SymbolTable* table, SignatureTable& signatures, DumpFile& dumpFile, const vector<int>& scopeReductions) : signatures(signatures), dumpFile(dumpFile), scopeReductions(scopeReductions) {
+        this->table = table;
+    }
+
+    // the global declarations of a unit, units must come in source order
+    void declareUnit(SymbolInfo* unit) {
+        SymbolInfo* declaration = unit->getChildren()[0];
+        const string& sType = declaration->getSType();
+
+        if (sType == "var_declaration") {
+            declareVariables(declaration);
+        } else if (sType == "func_declaration") {
+            insertFunctionDeclaration(declaration);
+        } else {
+            declareFunction(declaration->getChildren()[1]);
+        }
+    }
+
+    // checks the body of a func_definition, table must see the global scope as it was before the body
+    void checkFunction(SymbolInfo* funcDefinition) {
+        vector<SymbolInfo*> parameters = funcDefinition->getChildren()[1]->getParameters();
+        checkTree(funcDefinition->getChildren().back(), parameters);
+    }
+
+    // a function definition cut short by a syntax error, declared after every finished unit
+    // symbols are what the parser had on its stack above the function id, bottom first,
+    // marked if they are the lcurl of a block still open, such a block is entered and never left
+    void checkUnfinishedFunction(SymbolInfo* function, const vector<pair<SymbolInfo*, bool>>& symbols) {
+        declareFunction(function);
+        vector<SymbolInfo*> parameters = function->getParameters();
+        bool inBody = false;
+        for (auto& symbol : symbols) {
+            SymbolInfo* node = symbol.first;
+            if (symbol.second) {
+                enterBlock(node, parameters);
+                inBody = true;
+            } else if (inBody && (!node->isLeaf() || (node->getSType() == "LCURL" && node->getReduction() > 0))) {
+                // a leaf is a token, or the LCURL of an empty block
+                checkTree(node, parameters);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef SIGNATURE_TABLE
+#define SIGNATURE_TABLE
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "symbolInfo.h"
+
+// interned function signatures: the return type and the parameter types of a function,
+// hashed once and numbered, so equal signatures have equal handles and a call or a
+// declaration/definition pair is matched by comparing two ints
+// intern only while no other thread uses the table, find is read-only
+
+using namespace std;
+
+struct Signature {
+    TypeKind returnType = TYPE_NONE;
+    vector<Type> parameters = {};
+
+    bool operator==(const Signature& other) const {
+        if (returnType != other.returnType || parameters.size() != other.parameters.size()) return false;
+        for (size_t i = 0; i < parameters.size(); i++) {
+            if (parameters[i].kind != other.parameters[i].kind || parameters[i].array != other.parameters[i].array) return false;
+        }
+        return true;
+    }
+};
+
+struct SignatureHash {
+    size_t operator()(const Signature& signature) const {
+        size_t hash = signature.returnType;
+        for (auto& type : signature.parameters) hash = hash * 31 + type.kind * 2 + type.array;
+        return hash;
+    }
+};
+
+// the signature of a function, or of a call to it, from its parameters or arguments
+inline Signature signatureOf(TypeKind returnType, const vector<SymbolInfo*>& parameters) {
+    Signature signature;
+    signature.returnType = returnType;
+    signature.parameters.reserve(parameters.size());
+    for (auto parameter : parameters) signature.parameters.push_back(parameter->getValueType());
+    return signature;
+}
+
+class SignatureTable {
+   private:
+    unordered_map<Signature, int, SignatureHash> handles;
+
+   public:
+    int intern(const Signature& signature) {
+        return handles.emplace(signature, handles.size()).first->second;
+    }
+
+    // -1 if no function has this signature
+    int find(const Signature& signature) const {
+        auto it = handles.find(signature);
+        return it == handles.end() ? -1 : it->second;
+    }
+};
+
+#endif
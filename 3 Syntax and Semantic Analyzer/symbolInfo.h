@@ -1,6 +1,7 @@
 #ifndef SYMBOL_INFO
 #define SYMBOL_INFO
 
+#include <cstdint>
 #include <iostream>
 #include <set>
 #include <vector>
@@ -49,17 +50,37 @@ const set<string> terminals{
     "THEN",
     "error"};
 
+// types of symbols and expressions, type checks compare these instead of type names
+enum TypeKind : uint8_t { TYPE_NONE, TYPE_INT, TYPE_FLOAT, TYPE_DOUBLE, TYPE_CHAR, TYPE_VOID, TYPE_ERROR };
+
+constexpr const char* typeNames[] = {"", "INT", "FLOAT", "DOUBLE", "CHAR", "VOID", "error"};
+
+// the kind named by a type_specifier or a type name, TYPE_NONE for anything else
+inline TypeKind typeOf(const string& name) {
+    for (int kind = TYPE_INT; kind <= TYPE_ERROR; kind++) {
+        if (name == typeNames[kind]) return (TypeKind)kind;
+    }
+    return TYPE_NONE;
+}
+
+struct Type {
+    TypeKind kind = TYPE_NONE;
+    bool array = false;
+};
+
 class SymbolInfo {
     // entry of hash value
    private:
     /* data */
-    string name = "", type = "", returnType = "", typeSpecifier = "", sType = "";
+    string name = "", type = "", sType = "";
     SymbolInfo* prev = nullptr;
     SymbolInfo* next = nullptr;
 
     bool functionDefinition = false;
     bool functionDeclaration = false;
-    bool array = false;
+    Type valueType;
+    TypeKind returnType = TYPE_NONE;
+    int signature = -1;  // handle of a function's signature in the SignatureTable
     int size = 0;
     vector<SymbolInfo*> declarations = {};
     vector<SymbolInfo*> parameters = {};
@@ -71,12 +92,21 @@ class SymbolInfo {
     bool leaf = false;
     int startLine = 0, endLine = 0;
 
+    // the reduction that built the node, or that declared the symbol, and its line,
+    // the semantic pass reports in this order
+    int reduction = 0, reductionLine = 0;
+
+    // list nodes (program, statements, declaration_list, parameter_list, arguments) keep the items of
+    // every reduction in one children vector instead of a left nested chain,
+    // a link is the number of children after a reduction and the end line it reached
+    vector<pair<int, int>> links = {};
+
    public:
-    SymbolInfo(string name = "", string type = "", string typeSpecifier = "", string returnType = "", int size = 0) {
+    SymbolInfo(string name = "", string type = "", TypeKind typeSpecifier = TYPE_NONE, TypeKind returnType = TYPE_NONE, int size = 0) {
         this->name = name;
         this->type = type;
         this->sType = type;
-        this->typeSpecifier = typeSpecifier;
+        this->valueType.kind = typeSpecifier;
         this->returnType = returnType;
         this->size = size;
         this->next = nullptr;
@@ -91,12 +121,11 @@ class SymbolInfo {
         type = symbolInfo->type;
         sType = symbolInfo->sType;
         returnType = symbolInfo->returnType;
-        typeSpecifier = symbolInfo->typeSpecifier;
+        valueType = symbolInfo->valueType;
         prev = symbolInfo->prev;
         next = symbolInfo->next;
         functionDeclaration = symbolInfo->functionDeclaration;
         functionDefinition = symbolInfo->functionDefinition;
-        array = symbolInfo->array;
         declarations = symbolInfo->declarations;
         parameters = symbolInfo->parameters;
     }
@@ -105,44 +134,48 @@ class SymbolInfo {
 
     string getName() { return name; }
     string getType() { return type; }
-    string getReturnType() { return returnType; }
-    string getTypeSpecifier() { return typeSpecifier; }
+    TypeKind getReturnType() { return returnType; }
+    TypeKind getTypeSpecifier() { return valueType.kind; }
+    Type getValueType() { return valueType; }
     int getSize() { return size; }
     SymbolInfo* getPrev() { return prev; }
     SymbolInfo* getNext() { return next; }
 
     void setFunctionDefinition(bool value) { functionDefinition = value; }
     void setFunctionDeclaration(bool value) { functionDeclaration = value; }
-    void setArray(bool value) { array = value; }
+    void setArray(bool value) { valueType.array = value; }
 
     void setName(string s) { name = s; }
     void setType(string s) {
         // TODO:
         type = s;
-        if (s == "INT" || s == "FLOAT" || s == "DOUBLE") {
-            typeSpecifier = s;
+        TypeKind kind = typeOf(s);
+        if (kind == TYPE_INT || kind == TYPE_FLOAT || kind == TYPE_DOUBLE) {
+            valueType.kind = kind;
         }
         if (s == "error") leaf = true;
     }
-    void setReturnType(string s) {
-        returnType = s;
-        typeSpecifier = s;
+    void setReturnType(TypeKind kind) {
+        returnType = kind;
+        valueType.kind = kind;
     }
-    void setTypeSpecifier(string s) { typeSpecifier = s; }
+    void setTypeSpecifier(TypeKind kind) { valueType.kind = kind; }
+    void setSignature(int handle) { signature = handle; }
+    int getSignature() { return signature; }
     void setSize(int s) { size = s; }
     void setPrev(SymbolInfo* prev) { this->prev = prev; }
     void setNext(SymbolInfo* next) { this->next = next; }
 
     bool isFunctionDefinition() { return functionDefinition; }
     bool isFunctionDeclaration() { return functionDeclaration; }
-    bool isArray() { return array; }
+    bool isArray() { return valueType.array; }
 
     void pushDeclaration(SymbolInfo* declaration) { declarations.push_back(declaration); }
     vector<SymbolInfo*> getDeclarations() { return declarations; }
     void setDeclarations(vector<SymbolInfo*> declarations) { this->declarations = declarations; }
 
     void pushParameter(SymbolInfo* parameter) { parameters.push_back(parameter); }
-    vector<SymbolInfo*> getParameters() { return parameters; }
+    const vector<SymbolInfo*>& getParameters() { return parameters; }
     void setParameters(vector<SymbolInfo*> parameters) { this->parameters = parameters; }
 
     // functions for building parse tree
@@ -172,7 +205,25 @@ class SymbolInfo {
     bool isLeaf() { return leaf; }
     int getStartLine() { return startLine; }
     int getEndLine() { return endLine; }
-    vector<SymbolInfo*> getChildren() { return children; }
+    void setReduction(int reduction, int line) {
+        this->reduction = reduction;
+        reductionLine = line;
+    }
+    int getReduction() { return reduction; }
+    int getReductionLine() { return reductionLine; }
+    const vector<SymbolInfo*>& getChildren() { return children; }
+    const string& getSType() { return sType; }
+
+    void pushListLink(vector<SymbolInfo*> items) {
+        for (auto item : items) pushChild(item);
+        links.push_back({(int)children.size(), endLine});
+    }
+
+    bool isList() { return !links.empty(); }
+    int getListLinks() { return links.size(); }
+    int getListLinkBegin(int link) { return link == 0 ? 0 : links[link - 1].first; }
+    int getListLinkEnd(int link) { return links[link].first; }
+    int getListLinkEndLine(int link) { return links[link].second; }
 
     string printNode() {
         string returnString = "";
@@ -195,10 +246,10 @@ class SymbolInfo {
 
     string print() {
         if (functionDeclaration || functionDefinition) {
-            return ("<" + this->getName() + ", " + this->getType() + ", " + this->getReturnType() + "> ");
+            return ("<" + this->getName() + ", " + this->getType() + ", " + typeNames[returnType] + "> ");
         }
 
-        if (array) {
+        if (valueType.array) {
             return ("<" + this->getName() + ", ARRAY, " + this->getType() + "> ");
         }
 
@@ -206,7 +257,7 @@ class SymbolInfo {
     }
 
     void printAll() {
-        cout << "\n\nname: " << this->getName() << "\ntype: " << this->getType() << "\nreturn: " << this->returnType << "\ntypeSpec: " << this->getTypeSpecifier() << "\nsize: " << to_string(this->getSize()) << "\nfunc_dec: " << this->isFunctionDeclaration() << "\nfunc_def: " << this->isFunctionDefinition() << "\narray: " << this->isArray() << "\nparams: ";
+        cout << "\n\nname: " << this->getName() << "\ntype: " << this->getType() << "\nreturn: " << typeNames[returnType] << "\ntypeSpec: " << typeNames[valueType.kind] << "\nsize: " << to_string(this->getSize()) << "\nfunc_dec: " << this->isFunctionDeclaration() << "\nfunc_def: " << this->isFunctionDefinition() << "\narray: " << this->isArray() << "\nparams: ";
 
         for (auto x : this->getParameters()) {
             cout << x->getName() << " ";
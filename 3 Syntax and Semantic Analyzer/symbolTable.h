@@ -12,9 +12,13 @@ class SymbolTable {
     /* data */
     int bucketSize;
     ScopeTable* currentScope;
-    ScopeTable** scopeStack;
+    ScopeTable** scopeStack = nullptr;
     int scopeCount;
 
+    // a table over the global scope of another table, which it does not own
+    ScopeTable* sharedScope = nullptr;
+    int visibleUntil = INT_MAX;
+
    public:
     SymbolTable(int bucketSize = DEFAULT_BUCKET_SIZE) {
         scopeCount = 0;
@@ -23,13 +27,30 @@ class SymbolTable {
         this->enterScope();
     }
 
+    // checks one function on its own: the global scope is shared read-only,
+    // and its symbols declared after the reduction visibleUntil are hidden
+    SymbolTable(ScopeTable* globalScope, int visibleUntil, int bucketSize = DEFAULT_BUCKET_SIZE) {
+        scopeCount = globalScope->getId();
+        currentScope = globalScope;
+        sharedScope = globalScope;
+        this->visibleUntil = visibleUntil;
+        this->bucketSize = bucketSize;
+    }
+
     ~SymbolTable() {
-        delete currentScope;
+        if (sharedScope != nullptr) {
+            while (currentScope != sharedScope) exitScope();
+        } else {
+            delete currentScope;
+        }
         delete[] scopeStack;
     }
 
-    void enterScope() {
-        ScopeTable* temp = new ScopeTable(bucketSize, ++scopeCount);
+    ScopeTable* getCurrentScope() { return currentScope; }
+
+    // id 0 numbers the scope after the last one entered
+    void enterScope(int id = 0) {
+        ScopeTable* temp = new ScopeTable(bucketSize, id == 0 ? ++scopeCount : id);
 
         if (currentScope == nullptr) {
             currentScope = temp;
@@ -74,7 +95,7 @@ class SymbolTable {
         ScopeTable* temp = currentScope;
 
         while (temp != nullptr) {
-            SymbolInfo* tempInfo = temp->lookup(name);
+            SymbolInfo* tempInfo = temp->lookup(name, temp->getId() == 1 ? visibleUntil : INT_MAX);
             if (tempInfo != nullptr) {
                 return tempInfo;
             }
@@ -93,7 +114,7 @@ class SymbolTable {
         string ret = "";
 
         while (temp != nullptr) {
-            ret += temp->print();
+            ret += temp->print(temp->getId() == 1 ? visibleUntil : INT_MAX);
             temp = temp->getParentScope();
         }
         return ret;
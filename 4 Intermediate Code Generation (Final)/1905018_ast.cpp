@@ -0,0 +1,76 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "1905018_ast.h"
+#include "1905018_generate_code.h"
+
+// reads an AST written by the compiler with AST_OUTPUT set
+// tree: prints the parse tree straight from the mapped file, as in 1905018_parseTree.txt
+// code: generates 1905018_code.asm from the AST, without lexing and parsing the source again
+
+// g++ -O2 -pthread -o 1905018_ast 1905018_ast.cpp
+// ./1905018_ast tree program.ast > parseTree.txt
+// ./1905018_ast code program.ast
+
+using namespace std;
+
+// the globals the code generator shares with the parser
+FILE* parseTreeOut;
+FILE* assemblyCodeOut;
+SymbolInfo* globalVarInfo = new SymbolInfo();
+SymbolTable* symbolTable = nullptr;
+int labelCount = 1;
+
+void printTree(AstFile& ast) {
+    string spaces;
+    vector<pair<uint32_t, int>> stack = {{ast.root(), 0}};
+    while (!stack.empty()) {
+        const AstNode& node = ast.node(stack.back().first);
+        int depth = stack.back().second;
+        stack.pop_back();
+
+        if ((int)spaces.size() < depth) spaces.resize(depth, ' ');
+        fwrite(spaces.data(), 1, depth, stdout);
+        fputs(astKindName(node.kind), stdout);
+        fputs(" :", stdout);
+        if (node.flags & AST_LEAF) printf(" %s", ast.text(node.name));
+        for (uint32_t i = 0; i < node.childCount; i++) printf(" %s", astKindName(ast.node(ast.children(node)[i]).kind));
+
+        if (node.flags & AST_LEAF)
+            printf("\t<Line: %d>\n", node.startLine);
+        else
+            printf(" \t<Line: %d-%d>\n", node.startLine, node.endLine);
+
+        for (uint32_t i = node.childCount; i > 0; i--) stack.push_back({ast.children(node)[i - 1], depth + 1});
+    }
+}
+
+void usage(char* program) {
+    fprintf(stderr, "usage: %s tree|code file.ast\n", program);
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3 || (strcmp(argv[1], "tree") != 0 && strcmp(argv[1], "code") != 0)) usage(argv[0]);
+
+    AstFile ast;
+    if (!ast.open(argv[2])) {
+        fprintf(stderr, "Cannot read the AST %s\n", argv[2]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "tree") == 0) {
+        printTree(ast);
+        return 0;
+    }
+
+    if ((assemblyCodeOut = fopen("1905018_code.asm", "w")) == NULL) {
+        fprintf(stderr, "Cannot open 1905018_code.asm\n");
+        return 1;
+    }
+    generateCode(loadAst(ast, globalVarInfo));
+    fclose(assemblyCodeOut);
+    return 0;
+}
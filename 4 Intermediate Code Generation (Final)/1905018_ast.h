@@ -0,0 +1,340 @@
+#ifndef AST_FILE
+#define AST_FILE
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "classes/symbolInfo.h"
+
+// compact binary form of the parse tree, written when AST_OUTPUT names a file
+// the file is read in place through mmap, without deserialization:
+// a header, then fixed size nodes, an index array and a string table
+// a node's children and declarations are ranges of the index array, and uses of a variable
+// share the node of its declaration, so any node can have more than one parent
+
+using namespace std;
+
+#define AST_MAGIC 0x31545341  // "AST1"
+#define AST_VERSION 1
+
+// the terminals keep their TokenKind, the non-terminals follow
+enum AstKind : uint16_t {
+    AST_START = TOKEN_NONE + 1,
+    AST_PROGRAM,
+    AST_UNIT,
+    AST_FUNC_DECLARATION,
+    AST_FUNC_DEFINITION,
+    AST_PARAMETER_LIST,
+    AST_COMPOUND_STATEMENT,
+    AST_VAR_DECLARATION,
+    AST_TYPE_SPECIFIER,
+    AST_DECLARATION_LIST,
+    AST_STATEMENTS,
+    AST_STATEMENT,
+    AST_EXPRESSION_STATEMENT,
+    AST_VARIABLE,
+    AST_EXPRESSION,
+    AST_LOGIC_EXPRESSION,
+    AST_REL_EXPRESSION,
+    AST_SIMPLE_EXPRESSION,
+    AST_TERM,
+    AST_UNARY_EXPRESSION,
+    AST_FACTOR,
+    AST_ARGUMENT_LIST,
+    AST_ARGUMENTS,
+    AST_KIND_COUNT
+};
+
+constexpr const char* nonTerminalNames[] = {
+    "start",
+    "program",
+    "unit",
+    "func_declaration",
+    "func_definition",
+    "parameter_list",
+    "compound_statement",
+    "var_declaration",
+    "type_specifier",
+    "declaration_list",
+    "statements",
+    "statement",
+    "expression_statement",
+    "variable",
+    "expression",
+    "logic_expression",
+    "rel_expression",
+    "simple_expression",
+    "term",
+    "unary_expression",
+    "factor",
+    "argument_list",
+    "arguments"};
+
+static_assert(sizeof(nonTerminalNames) / sizeof(nonTerminalNames[0]) == AST_KIND_COUNT - AST_START, "a name for every non-terminal");
+
+inline const char* astKindName(uint16_t kind) {
+    if (kind < TOKEN_NONE) return tokenNames[kind];
+    if (kind >= AST_START && kind < AST_KIND_COUNT) return nonTerminalNames[kind - AST_START];
+    return "";
+}
+
+// node flags
+#define AST_LEAF 1
+#define AST_ARRAY 2
+
+struct AstNode {
+    uint16_t kind;
+    uint16_t flags;
+    uint32_t name;           // string table offsets
+    uint32_t typeSpecifier;
+    int32_t startLine, endLine;
+    int32_t size;            // length of a declared array
+    uint32_t firstChild, childCount;              // range of the index array
+    uint32_t firstDeclaration, declarationCount;  // declaration_list: the ids it declares
+};
+
+struct AstHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t indexCount;
+    uint32_t stringSize;
+    uint32_t root;
+    uint32_t firstGlobal, globalCount;  // global variables, a range of the index array
+    uint64_t nodesOffset, indicesOffset, stringsOffset;
+};
+
+// writes the tree under root, with the global variables of globals->getDeclarations()
+inline bool writeAst(SymbolInfo* root, SymbolInfo* globals, string path) {
+    unordered_map<string, uint16_t> kinds;
+    for (int kind = AST_START; kind < AST_KIND_COUNT; kind++) kinds[nonTerminalNames[kind - AST_START]] = kind;
+
+    // number the nodes in pre-order, a shared node keeps its first number
+    // only the node of a declared ID may be shared, as AstFile checks when the file is read
+    unordered_map<SymbolInfo*, uint32_t> numbers;
+    vector<SymbolInfo*> order;
+    auto globalVars = globals->getDeclarations();
+    vector<SymbolInfo*> stack(globalVars.rbegin(), globalVars.rend());
+    stack.push_back(root);
+    while (!stack.empty()) {
+        SymbolInfo* node = stack.back();
+        stack.pop_back();
+        if (!numbers.emplace(node, order.size()).second) {
+            bool shared = node->getKind() == TOKEN_ID && node->isLeaf() && node->getChildren().empty() && node->getDeclarations().empty();
+            if (!shared) return false;
+            continue;
+        }
+        order.push_back(node);
+        auto children = node->getChildren();
+        auto declarations = node->getDeclarations();
+        stack.insert(stack.end(), declarations.rbegin(), declarations.rend());
+        stack.insert(stack.end(), children.rbegin(), children.rend());
+    }
+
+    string strings(1, '\0');  // offset 0 is the empty string
+    unordered_map<string, uint32_t> stringOffsets = {{"", 0}};
+    auto intern = [&](string s) {
+        auto it = stringOffsets.find(s);
+        if (it != stringOffsets.end()) return it->second;
+        uint32_t offset = strings.size();
+        strings.append(s.c_str(), s.size() + 1);
+        stringOffsets[s] = offset;
+        return offset;
+    };
+
+    vector<AstNode> nodes;
+    vector<uint32_t> indices;
+    for (auto node : order) {
+        AstNode record = {};
+        if (node->getKind() != TOKEN_NONE) {
+            record.kind = node->getKind();
+        } else if (kinds.count(node->getSType())) {
+            record.kind = kinds[node->getSType()];
+        } else {
+            return false;
+        }
+        record.flags = (node->isLeaf() ? AST_LEAF : 0) | (node->isArray() ? AST_ARRAY : 0);
+        record.name = intern(node->getName());
+        record.typeSpecifier = intern(node->getTypeSpecifier());
+        record.startLine = node->getStartLine();
+        record.endLine = node->getEndLine();
+        record.size = node->getSize();
+
+        record.firstChild = indices.size();
+        for (auto child : node->getChildren()) indices.push_back(numbers[child]);
+        record.childCount = indices.size() - record.firstChild;
+        record.firstDeclaration = indices.size();
+        for (auto declaration : node->getDeclarations()) indices.push_back(numbers[declaration]);
+        record.declarationCount = indices.size() - record.firstDeclaration;
+        nodes.push_back(record);
+    }
+
+    AstHeader header = {};
+    header.magic = AST_MAGIC;
+    header.version = AST_VERSION;
+    header.root = numbers[root];
+    header.firstGlobal = indices.size();
+    for (auto globalVar : globalVars) indices.push_back(numbers[globalVar]);
+    header.globalCount = globalVars.size();
+    header.nodeCount = nodes.size();
+    header.indexCount = indices.size();
+    header.stringSize = strings.size();
+    header.nodesOffset = sizeof(AstHeader);
+    header.indicesOffset = header.nodesOffset + nodes.size() * sizeof(AstNode);
+    header.stringsOffset = header.indicesOffset + indices.size() * sizeof(uint32_t);
+
+    // written under a temporary name, a reader never maps a half written file
+    string temp = path + "." + to_string(getpid()) + ".tmp";
+    FILE* out = fopen(temp.c_str(), "wb");
+    if (out == NULL) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = ok && fwrite(nodes.data(), sizeof(AstNode), nodes.size(), out) == nodes.size();
+    ok = ok && fwrite(indices.data(), sizeof(uint32_t), indices.size(), out) == indices.size();
+    ok = ok && fwrite(strings.data(), 1, strings.size(), out) == strings.size();
+    ok = fclose(out) == 0 && ok;
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// a mapped AST file, the accessors point into the mapping
+class AstFile {
+    int fd = -1;
+    void* data = MAP_FAILED;
+    size_t length = 0;
+    const AstHeader* header = nullptr;
+    const AstNode* nodes = nullptr;
+    const uint32_t* indices = nullptr;
+    const char* strings = nullptr;
+
+    bool valid() {
+        if (length < sizeof(AstHeader)) return false;
+        if (header->magic != AST_MAGIC || header->version != AST_VERSION) return false;
+        if (header->nodesOffset != sizeof(AstHeader)) return false;
+        if (header->indicesOffset != header->nodesOffset + (uint64_t)header->nodeCount * sizeof(AstNode)) return false;
+        if (header->stringsOffset != header->indicesOffset + (uint64_t)header->indexCount * sizeof(uint32_t)) return false;
+        if (header->stringsOffset + header->stringSize != length || header->stringSize == 0) return false;
+        if (((const char*)data)[length - 1] != '\0' || header->root >= header->nodeCount) return false;
+        if ((uint64_t)header->firstGlobal + header->globalCount > header->indexCount) return false;
+
+        const AstNode* nodes = (const AstNode*)((const char*)data + header->nodesOffset);
+        const uint32_t* indices = (const uint32_t*)((const char*)data + header->indicesOffset);
+        for (uint32_t i = 0; i < header->nodeCount; i++) {
+            const AstNode& node = nodes[i];
+            if (node.kind >= TOKEN_NONE && (node.kind < AST_START || node.kind >= AST_KIND_COUNT)) return false;
+            if (node.name >= header->stringSize || node.typeSpecifier >= header->stringSize) return false;
+            if ((uint64_t)node.firstChild + node.childCount > header->indexCount) return false;
+            if ((uint64_t)node.firstDeclaration + node.declarationCount > header->indexCount) return false;
+        }
+        for (uint32_t i = 0; i < header->indexCount; i++) {
+            if (indices[i] >= header->nodeCount) return false;
+        }
+
+        // the writer numbers the nodes in pre-order, so a reference points to a later node unless it is
+        // to the shared node of a declared ID, which has no children of its own; anything else is a cycle
+        // or a node reached twice
+        auto shared = [&](uint32_t i) {
+            const AstNode& node = nodes[i];
+            return node.kind == TOKEN_ID && (node.flags & AST_LEAF) && node.childCount == 0 && node.declarationCount == 0;
+        };
+        vector<bool> referenced(header->nodeCount, false);
+        auto reference = [&](uint32_t from, uint32_t to) {
+            if ((to <= from || referenced[to]) && !shared(to)) return false;
+            referenced[to] = true;
+            return true;
+        };
+        for (uint32_t i = 0; i < header->nodeCount; i++) {
+            const AstNode& node = nodes[i];
+            for (uint32_t c = 0; c < node.childCount; c++) {
+                if (!reference(i, indices[node.firstChild + c])) return false;
+            }
+            for (uint32_t d = 0; d < node.declarationCount; d++) {
+                if (!reference(i, indices[node.firstDeclaration + d])) return false;
+            }
+        }
+        for (uint32_t g = 0; g < header->globalCount; g++) {
+            if (!shared(indices[header->firstGlobal + g])) return false;
+        }
+        return !referenced[header->root];
+    }
+
+   public:
+    ~AstFile() {
+        if (data != MAP_FAILED) munmap(data, length);
+        if (fd != -1) close(fd);
+    }
+
+    bool open(string path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) return false;
+        length = st.st_size;
+        data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) return false;
+
+        header = (const AstHeader*)data;
+        if (!valid()) return false;
+        nodes = (const AstNode*)((const char*)data + header->nodesOffset);
+        indices = (const uint32_t*)((const char*)data + header->indicesOffset);
+        strings = (const char*)data + header->stringsOffset;
+        return true;
+    }
+
+    uint32_t nodeCount() { return header->nodeCount; }
+    uint32_t root() { return header->root; }
+    const AstNode& node(uint32_t i) { return nodes[i]; }
+    const char* text(uint32_t offset) { return strings + offset; }
+
+    const uint32_t* children(const AstNode& node) { return indices + node.firstChild; }
+    const uint32_t* declarations(const AstNode& node) { return indices + node.firstDeclaration; }
+    const uint32_t* globals() { return indices + header->firstGlobal; }
+    uint32_t globalCount() { return header->globalCount; }
+};
+
+// builds the SymbolInfo tree the code generator walks, the global variables are pushed to globals
+inline SymbolInfo* loadAst(AstFile& ast, SymbolInfo* globals) {
+    vector<SymbolInfo*> symbols(ast.nodeCount());
+    for (uint32_t i = 0; i < ast.nodeCount(); i++) {
+        const AstNode& node = ast.node(i);
+        SymbolInfo* symbol;
+        if (node.kind < TOKEN_NONE) {
+            symbol = new SymbolInfo(ast.text(node.name), (TokenKind)node.kind, ast.text(node.typeSpecifier));
+        } else {
+            symbol = new SymbolInfo(ast.text(node.name), astKindName(node.kind), ast.text(node.typeSpecifier));
+        }
+        symbol->setLeaf(node.flags & AST_LEAF);
+        symbol->setArray(node.flags & AST_ARRAY);
+        symbol->setSize(node.size);
+        symbols[i] = symbol;
+    }
+
+    // nothing is reduced when the tree is read back, setChildren must not count its nodes
+    long long reductions = compilerStats.reductions;
+    for (uint32_t i = 0; i < ast.nodeCount(); i++) {
+        const AstNode& node = ast.node(i);
+        vector<SymbolInfo*> children;
+        for (uint32_t c = 0; c < node.childCount; c++) children.push_back(symbols[ast.children(node)[c]]);
+        symbols[i]->setChildren(children);
+        for (uint32_t d = 0; d < node.declarationCount; d++) symbols[i]->pushDeclaration(symbols[ast.declarations(node)[d]]);
+        symbols[i]->setStartLine(node.startLine);
+        symbols[i]->setEndLine(node.endLine);
+    }
+    compilerStats.reductions = reductions;
+
+    for (uint32_t g = 0; g < ast.globalCount(); g++) globals->pushDeclaration(symbols[ast.globals()[g]]);
+    return symbols[ast.root()];
+}
+
+#endif
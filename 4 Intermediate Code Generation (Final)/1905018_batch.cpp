@@ -0,0 +1,184 @@
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "1905018_cache.h"
+
+// batch driver: compiles many source files concurrently
+// the compiler keeps its state in globals and writes fixed file names into the
+// working directory, so every file is compiled by its own compiler process
+// running inside its own output directory (<output>/<file name>/)
+
+// g++ -O2 -o 1905018_batch 1905018_batch.cpp
+// ./1905018_batch [-j workers] [-o output] [-c compiler] [-C cache [-s megabytes]] file...
+// with -C, files already compiled with the same source, compiler and CODEGEN_*, LOG_* and AST_* variables are copied from the cache
+
+using namespace std;
+
+struct Job {
+    string input;      // absolute path of the source file
+    string outputDir;  // absolute path of the per file output directory
+    uint64_t cacheKey = 0;
+    pid_t pid = -1;
+    int status = 0;
+};
+
+string absolutePath(string path) {
+    char resolved[PATH_MAX];
+    if (realpath(path.c_str(), resolved) == NULL) return "";
+    return resolved;
+}
+
+string stem(string path) {
+    int slash = path.find_last_of('/');
+    string name = path.substr(slash + 1);
+    int dot = name.find_last_of('.');
+    if (dot > 0) name = name.substr(0, dot);
+    return name;
+}
+
+bool makeDirectory(string path) {
+    return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+pid_t startCompiler(string compiler, Job& job) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (chdir(job.outputDir.c_str()) != 0) _exit(127);
+        execl(compiler.c_str(), compiler.c_str(), job.input.c_str(), (char*)NULL);
+        _exit(127);
+    }
+    return pid;
+}
+
+void usage(char* program) {
+    cerr << "usage: " << program << " [-j workers] [-o output] [-c compiler] [-C cache [-s megabytes]] file...\n";
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    int workers = sysconf(_SC_NPROCESSORS_ONLN);
+    string outputRoot = "batch_output";
+    string compiler = "./1905018";
+    string cacheDir = "";
+    uint64_t cacheSize = 256;
+    vector<string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputRoot = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            compiler = argv[++i];
+        } else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            cacheSize = atoll(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (inputs.empty() || workers < 1) usage(argv[0]);
+
+    compiler = absolutePath(compiler);
+    if (compiler == "" || !makeDirectory(outputRoot)) {
+        cerr << "Cannot find the compiler or create the output directory.\n";
+        return 1;
+    }
+    outputRoot = absolutePath(outputRoot);
+
+    CompileCache cache;
+    bool cached = cacheDir != "";
+    if (cached && !cache.open(cacheDir, cacheSize << 20, compiler)) {
+        cerr << "Cannot open the cache " << cacheDir << "\n";
+        return 1;
+    }
+
+    // one output directory per input, suffixed when two inputs share a name
+    vector<Job> jobs;
+    map<string, int> stemCount;
+    for (auto input : inputs) {
+        Job job;
+        job.input = absolutePath(input);
+        if (job.input == "") {
+            cerr << "Cannot Open Input File " << input << "\n";
+            continue;
+        }
+
+        string name = stem(input);
+        int count = stemCount[name]++;
+        if (count > 0) name += "_" + to_string(count);
+        job.outputDir = outputRoot + "/" + name;
+        if (!makeDirectory(job.outputDir)) {
+            cerr << "Cannot create " << job.outputDir << "\n";
+            continue;
+        }
+        // outputs of an earlier run would otherwise be mixed with (and cached as) this one's
+        clearDirectory(job.outputDir);
+        jobs.push_back(job);
+    }
+
+    auto start = chrono::steady_clock::now();
+
+    map<pid_t, int> running;
+    int next = 0, failed = 0;
+    while (next < (int)jobs.size() || !running.empty()) {
+        while (next < (int)jobs.size() && (int)running.size() < workers) {
+            if (cached) {
+                jobs[next].cacheKey = cache.key(jobs[next].input);
+                if (jobs[next].cacheKey != 0 && cache.fetch(jobs[next].cacheKey, jobs[next].outputDir)) {
+                    next++;
+                    continue;
+                }
+            }
+            jobs[next].pid = startCompiler(compiler, jobs[next]);
+            if (jobs[next].pid < 0) {
+                failed++;
+            } else {
+                running[jobs[next].pid] = next;
+            }
+            next++;
+        }
+
+        if (running.empty()) continue;
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) break;
+        if (!running.count(pid)) continue;
+
+        Job& job = jobs[running[pid]];
+        running.erase(pid);
+        job.status = status;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed++;
+            cerr << "failed: " << job.input << "\n";
+        } else if (cached && job.cacheKey != 0) {
+            cache.store(job.cacheKey, job.outputDir);
+        }
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("compiled %d files (%d failed) with %d workers in %.3f s, %.1f files/s\n",
+           (int)jobs.size(), failed, workers, seconds, seconds > 0 ? jobs.size() / seconds : 0.0);
+    if (cached) {
+        printf("cache: %d hits, %d misses, %d evicted (total %llu hits, %llu misses, %.1f MB)\n",
+               cache.hits, cache.misses, cache.evictions, (unsigned long long)cache.totalHits(),
+               (unsigned long long)cache.totalMisses(), cache.totalSize() / 1048576.0);
+    }
+
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,308 @@
+#ifndef COMPILE_CACHE
+#define COMPILE_CACHE
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// content addressed cache of compiled files, used by the batch driver
+// an entry is a directory <cache>/<key>/ holding the files the compiler wrote (code, parse tree, log),
+// the key hashes the source, the compiler binary and the environment variables that change the output
+// the index is a memory mapped open addressing table of entry sizes and last uses,
+// entries are evicted least recently used first once the cache grows over its size limit
+
+using namespace std;
+
+#define CACHE_VERSION 1
+#define CACHE_SLOTS 4096
+
+// reserved keys
+#define CACHE_EMPTY 0
+#define CACHE_REMOVED 1
+
+// the compiler is configured through environment variables with these prefixes, all of them are
+// part of the key, so a new setting never serves entries written without it
+const char* cacheFlagPrefixes[] = {"CODEGEN_", "LOG_", "AST_"};
+
+extern char** environ;
+
+// the NAME=value settings of the compiler, sorted
+vector<string> compilerSettings() {
+    vector<string> settings;
+    for (char** variable = environ; *variable != NULL; variable++) {
+        for (auto prefix : cacheFlagPrefixes) {
+            if (strncmp(*variable, prefix, strlen(prefix)) == 0) settings.push_back(*variable);
+        }
+    }
+    sort(settings.begin(), settings.end());
+    return settings;
+}
+
+struct CacheRecord {
+    uint64_t key;
+    uint64_t size;
+    uint64_t lastUsed;
+};
+
+struct CacheIndex {
+    uint64_t version;
+    uint64_t clock;  // bumped on every use, orders the entries for eviction
+    uint64_t totalSize;
+    uint64_t entries;
+    uint64_t hits, misses, evictions;  // over the lifetime of the cache
+    CacheRecord records[CACHE_SLOTS];
+};
+
+uint64_t hashBytes(uint64_t hash, const char* bytes, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool hashFile(uint64_t& hash, string path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL) return false;
+    char buffer[1 << 16];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) hash = hashBytes(hash, buffer, length);
+    fclose(file);
+    return true;
+}
+
+bool copyFile(string from, string to) {
+    FILE* in = fopen(from.c_str(), "rb");
+    if (in == NULL) return false;
+    FILE* out = fopen(to.c_str(), "wb");
+    if (out == NULL) {
+        fclose(in);
+        return false;
+    }
+    char buffer[1 << 16];
+    size_t length;
+    bool ok = true;
+    while ((length = fread(buffer, 1, sizeof(buffer), in)) > 0) ok = ok && fwrite(buffer, 1, length, out) == length;
+    fclose(in);
+    return fclose(out) == 0 && ok;
+}
+
+// regular files directly inside a directory
+vector<string> listFiles(string dir) {
+    vector<string> files;
+    DIR* d = opendir(dir.c_str());
+    if (d == NULL) return files;
+    while (dirent* entry = readdir(d)) {
+        struct stat st;
+        string name = entry->d_name;
+        if (stat((dir + "/" + name).c_str(), &st) == 0 && S_ISREG(st.st_mode)) files.push_back(name);
+    }
+    closedir(d);
+    return files;
+}
+
+void clearDirectory(string dir) {
+    for (auto name : listFiles(dir)) unlink((dir + "/" + name).c_str());
+}
+
+void removeDirectory(string dir) {
+    clearDirectory(dir);
+    rmdir(dir.c_str());
+}
+
+class CompileCache {
+    string dir;
+    uint64_t maxSize;
+    uint64_t compilerHash = 0;
+    int fd = -1;
+    CacheIndex* index = nullptr;
+
+    string entryDir(uint64_t key) {
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+        return dir + "/" + name;
+    }
+
+    // the slot holding key, or -1
+    int findSlot(uint64_t key) {
+        for (int i = 0; i < CACHE_SLOTS; i++) {
+            CacheRecord& record = index->records[(key + i) % CACHE_SLOTS];
+            if (record.key == key) return (key + i) % CACHE_SLOTS;
+            if (record.key == CACHE_EMPTY) return -1;
+        }
+        return -1;
+    }
+
+    int freeSlot(uint64_t key) {
+        for (int i = 0; i < CACHE_SLOTS; i++) {
+            CacheRecord& record = index->records[(key + i) % CACHE_SLOTS];
+            if (record.key == CACHE_EMPTY || record.key == CACHE_REMOVED) return (key + i) % CACHE_SLOTS;
+        }
+        return -1;
+    }
+
+    void removeSlot(int slot) {
+        CacheRecord& record = index->records[slot];
+        removeDirectory(entryDir(record.key));
+        index->totalSize -= record.size;
+        index->entries--;
+        record = {CACHE_REMOVED, 0, 0};
+    }
+
+    void evictOldest() {
+        int oldest = -1;
+        for (int i = 0; i < CACHE_SLOTS; i++) {
+            uint64_t key = index->records[i].key;
+            if (key == CACHE_EMPTY || key == CACHE_REMOVED) continue;
+            if (oldest == -1 || index->records[i].lastUsed < index->records[oldest].lastUsed) oldest = i;
+        }
+        if (oldest == -1) return;
+        removeSlot(oldest);
+        index->evictions++;
+        evictions++;
+    }
+
+   public:
+    // this run
+    int hits = 0, misses = 0, evictions = 0;
+
+    ~CompileCache() {
+        if (index != nullptr) munmap(index, sizeof(CacheIndex));
+        if (fd != -1) close(fd);
+    }
+
+    bool open(string dir, uint64_t maxSize, string compiler) {
+        this->dir = dir;
+        this->maxSize = maxSize;
+
+        string version = "cache " + to_string(CACHE_VERSION) + "\n";
+        compilerHash = hashBytes(14695981039346656037ULL, version.c_str(), version.size());
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (!hashFile(compilerHash, compiler)) return false;
+
+        fd = ::open((dir + "/index").c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd == -1) return false;
+        flock(fd, LOCK_EX);
+        struct stat st;
+        bool fresh = fstat(fd, &st) == 0 && st.st_size != sizeof(CacheIndex);
+        if (fresh && ftruncate(fd, sizeof(CacheIndex)) != 0) {
+            flock(fd, LOCK_UN);
+            return false;
+        }
+
+        void* mapped = mmap(NULL, sizeof(CacheIndex), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            flock(fd, LOCK_UN);
+            return false;
+        }
+        index = (CacheIndex*)mapped;
+
+        // an index from another layout cannot be trusted, start over
+        if (fresh || index->version != CACHE_VERSION) {
+            for (int i = 0; i < CACHE_SLOTS; i++) {
+                uint64_t key = index->records[i].key;
+                if (!fresh && key != CACHE_EMPTY && key != CACHE_REMOVED) removeDirectory(entryDir(key));
+            }
+            memset(index, 0, sizeof(CacheIndex));
+            index->version = CACHE_VERSION;
+        }
+        flock(fd, LOCK_UN);
+        return true;
+    }
+
+    // 0 when the source cannot be read
+    uint64_t key(string input) {
+        uint64_t hash = compilerHash;
+        for (auto setting : compilerSettings()) {
+            setting += "\n";
+            hash = hashBytes(hash, setting.c_str(), setting.size());
+        }
+        if (!hashFile(hash, input)) return 0;
+        return hash > CACHE_REMOVED ? hash : hash + 2;
+    }
+
+    // copies the cached outputs of key into outputDir
+    // an entry whose directory is missing or empty is a miss and is dropped from the index
+    bool fetch(uint64_t key, string outputDir) {
+        flock(fd, LOCK_EX);
+        int slot = findSlot(key);
+        bool hit = false;
+        if (slot != -1) {
+            string entry = entryDir(key);
+            vector<string> files = listFiles(entry);
+            hit = !files.empty();
+            for (auto name : files) hit = hit && copyFile(entry + "/" + name, outputDir + "/" + name);
+            if (hit) {
+                index->records[slot].lastUsed = ++index->clock;
+            } else {
+                removeSlot(slot);
+            }
+        }
+
+        if (hit) {
+            index->hits++;
+            hits++;
+        } else {
+            index->misses++;
+            misses++;
+        }
+        flock(fd, LOCK_UN);
+        return hit;
+    }
+
+    // stores the files in outputDir, which the caller empties before compiling
+    // so that only the outputs of this compile end up under key
+    void store(uint64_t key, string outputDir) {
+        // copied under a temporary name first, readers only find complete entries
+        string entry = entryDir(key);
+        string temp = entry + "." + to_string(getpid()) + ".tmp";
+        if (mkdir(temp.c_str(), 0755) != 0) return;
+
+        uint64_t size = 0;
+        for (auto name : listFiles(outputDir)) {
+            struct stat st;
+            if (!copyFile(outputDir + "/" + name, temp + "/" + name) || stat((temp + "/" + name).c_str(), &st) != 0) {
+                removeDirectory(temp);
+                return;
+            }
+            size += st.st_size;
+        }
+        if (size > maxSize) {
+            removeDirectory(temp);
+            return;
+        }
+
+        flock(fd, LOCK_EX);
+        if (findSlot(key) == -1) removeDirectory(entry);  // left behind by an interrupted run
+        if (findSlot(key) != -1 || rename(temp.c_str(), entry.c_str()) != 0) {
+            flock(fd, LOCK_UN);
+            removeDirectory(temp);
+            return;
+        }
+
+        while (index->entries > 0 && (index->totalSize + size > maxSize || freeSlot(key) == -1)) evictOldest();
+        int slot = freeSlot(key);
+        index->records[slot] = {key, size, ++index->clock};
+        index->totalSize += size;
+        index->entries++;
+        flock(fd, LOCK_UN);
+    }
+
+    uint64_t totalHits() { return index->hits; }
+    uint64_t totalMisses() { return index->misses; }
+    uint64_t totalSize() { return index->totalSize; }
+};
+
+#endif
@@ -1,8 +1,24 @@
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
-
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "1905018_ast.h"
+#include "classes/compilerStats.h"
 #include "classes/symbolInfo.h"
 #include "classes/symbolTable.h"
 
@@ -13,78 +29,342 @@ extern FILE* assemblyCodeOut;
 extern SymbolInfo* globalVarInfo;
 extern SymbolTable* symbolTable;
 extern int labelCount;
-extern int stackBufferOffset;
 
-int globalArrayOffset = 0;
+// per thread state, so that function definitions can be generated concurrently
+// a worker writes the function into codeBuffer, numbering its labels from 0 and its lines
+// from the function's first line, both are rebased when the buffers are written out in source order
+thread_local string* codeBuffer = nullptr;
+thread_local int* functionLabelCount = nullptr;
+thread_local int functionStartLine = 0;
+thread_local int functionStackOffset = 0;
+
+// the function being generated, for tail calls: its parameters, the label after its prologue,
+// the stack offset there and the number of arguments its caller pushed
+thread_local string functionName = "";
+thread_local vector<SymbolInfo*> functionParameters;
+thread_local int functionEntryLabel = -1;
+thread_local int functionEntryOffset = 0;
+thread_local int functionPushedArguments = 0;
+
+// set while a value is only needed in AX, see narrowIndex
+thread_local bool narrowValues = false;
+
+// generateCode runs the rules from an explicit stack, so nesting in the program does not grow the
+// native stack: a rule prints what comes before its first child and schedules the rest, children
+// to generate and code to print after them, which runs in the order it was scheduled
+struct CodegenStep {
+    SymbolInfo* node;  // generated, if there is no action
+    function<void()> action;
+};
+thread_local vector<CodegenStep> codegenSteps;
+thread_local vector<CodegenStep> scheduledSteps;
+
+void generateLater(SymbolInfo* node) {
+    scheduledSteps.push_back({node, nullptr});
+}
+
+void printLater(function<void()> action) {
+    scheduledSteps.push_back({nullptr, action});
+}
+
+#define LABEL_MARK '\x01'
+#define LINE_MARK '\x03'
+#define MARK_END '\x02'
+
+// runtime: println appends to OUTPUT_BUFFER, which is written with one INT 21H (AH=40H, stdout)
+// when it fills up and when main exits, instead of three INT 21H calls per line
+// a number is converted two digits per division, the pairs are read from DIGITS
+
+// "000102...99"
+string digitPairs() {
+    string digits;
+    for (int i = 0; i < 100; i++) {
+        digits += '0' + i / 10;
+        digits += '0' + i % 10;
+    }
+    return digits;
+}
+
+// NUMBER holds the digits of the largest int, 5 for 16 bits and 10 for 32 bits (rounded up to pairs)
+string runtimeData(bool wide) {
+    return "\tCR EQU 0DH\n\
+\tLF EQU 0AH\n\
+\tOUTPUT_SIZE EQU 256\n\
+\tNUMBER DB " + string(wide ? "10" : "6") + " DUP(0)\n\
+\tDIGITS DB \"" + digitPairs() + "\"\n\
+\tOUTPUT_BUFFER DB OUTPUT_SIZE DUP(0)\n\
+\tEVEN\n\
+\tOUTPUT_LENGTH DW 0\n";
+}
 
 string newLineProc =
     "new_line PROC\n\
-\tPUSH AX\n\
-\tPUSH DX\n\
-\tMOV AH, 2\n\
-\tMOV DL, CR\n\
-\tINT 21H\n\
-\tMOV AH, 2\n\
-\tMOV DL, LF\n\
-\tINT 21H\n\
-\tPOP DX\n\
-\tPOP AX\n\
+\tPUSH BX\n\
+\tCMP OUTPUT_LENGTH, OUTPUT_SIZE-2\n\
+\tJBE NEW_LINE_ROOM\n\
+\tCALL flush_output\n\
+NEW_LINE_ROOM:\n\
+\tMOV BX, OUTPUT_LENGTH\n\
+\tMOV BYTE PTR OUTPUT_BUFFER[BX], CR\n\
+\tMOV BYTE PTR OUTPUT_BUFFER[BX+1], LF\n\
+\tADD OUTPUT_LENGTH, 2\n\
+\tPOP BX\n\
 \tRET\n\
 new_line ENDP\n";
 
+// the digits are written backwards into NUMBER and copied to the buffer,
+// -32768 is negated to 32768, which is right as an unsigned word
 string printOutputProc =
     "print_output PROC\n\
 \tPUSH AX\n\
+\tPUSH BX\n\
 \tPUSH CX\n\
 \tPUSH DX\n\
 \tPUSH SI\n\
-\tLEA SI,NUMBER\n\
-\tADD SI,4\n\
-\tCMP AX,0\n\
-\tJNGE NEGATE\n\
-PRINT:\n\
-\tXOR DX,DX\n\
-\tDIV TEN\n\
-\tMOV [SI],DL\n\
-\tADD [SI],'0'\n\
-\tDEC SI\n\
-\tCMP AX,0\n\
-\tJNE PRINT\n\
+\tPUSH DI\n\
+\tCMP OUTPUT_LENGTH, OUTPUT_SIZE-8\n\
+\tJBE PRINT_ROOM\n\
+\tCALL flush_output\n\
+PRINT_ROOM:\n\
+\tMOV DI, OFFSET OUTPUT_BUFFER\n\
+\tADD DI, OUTPUT_LENGTH\n\
+\tCMP AX, 0\n\
+\tJGE PRINT_DIGITS\n\
+\tMOV BYTE PTR [DI], '-'\n\
+\tINC DI\n\
+\tNEG AX\n\
+PRINT_DIGITS:\n\
+\tMOV SI, OFFSET NUMBER+6\n\
+\tMOV CX, 100\n\
+PRINT_PAIR:\n\
+\tXOR DX, DX\n\
+\tDIV CX\n\
+\tMOV BX, DX\n\
+\tSHL BX, 1\n\
+\tMOV DX, WORD PTR DIGITS[BX]\n\
+\tSUB SI, 2\n\
+\tMOV [SI], DX\n\
+\tCMP AX, 0\n\
+\tJNE PRINT_PAIR\n\
+\tCMP BYTE PTR [SI], '0'\n\
+\tJNE PRINT_COPY\n\
 \tINC SI\n\
-\tLEA DX,SI\n\
-\tMOV AH,9\n\
-\tINT 21H\n\
+PRINT_COPY:\n\
+\tMOV CX, OFFSET NUMBER+6\n\
+\tSUB CX, SI\n\
+\tCLD\n\
+\tREP MOVSB\n\
+\tSUB DI, OFFSET OUTPUT_BUFFER\n\
+\tMOV OUTPUT_LENGTH, DI\n\
+\tPOP DI\n\
 \tPOP SI\n\
 \tPOP DX\n\
 \tPOP CX\n\
+\tPOP BX\n\
 \tPOP AX\n\
 \tRET\n\
-NEGATE:\n\
+print_output ENDP\n";
+
+string flushOutputProc =
+    "flush_output PROC\n\
 \tPUSH AX\n\
-\tMOV AH,02H\n\
-\tMOV DL,'-'\n\
+\tPUSH BX\n\
+\tPUSH CX\n\
+\tPUSH DX\n\
+\tMOV CX, OUTPUT_LENGTH\n\
+\tJCXZ FLUSH_DONE\n\
+\tMOV AH, 40H\n\
+\tMOV BX, 1\n\
+\tMOV DX, OFFSET OUTPUT_BUFFER\n\
 \tINT 21H\n\
+\tMOV OUTPUT_LENGTH, 0\n\
+FLUSH_DONE:\n\
+\tPOP DX\n\
+\tPOP CX\n\
+\tPOP BX\n\
 \tPOP AX\n\
+\tRET\n\
+flush_output ENDP\n";
+
+// print_output for a 32 bit int in DX:AX, DX:AX / 100 is two word divisions, the high word first
+// -2147483648 is negated to 2147483648, which is right as an unsigned double word
+string printOutputWideProc =
+    "print_output PROC\n\
+\tPUSH AX\n\
+\tPUSH BX\n\
+\tPUSH CX\n\
+\tPUSH DX\n\
+\tPUSH SI\n\
+\tPUSH DI\n\
+\tCMP OUTPUT_LENGTH, OUTPUT_SIZE-13\n\
+\tJBE PRINT_ROOM\n\
+\tCALL flush_output\n\
+PRINT_ROOM:\n\
+\tMOV DI, OFFSET OUTPUT_BUFFER\n\
+\tADD DI, OUTPUT_LENGTH\n\
+\tCMP DX, 0\n\
+\tJGE PRINT_DIGITS\n\
+\tMOV BYTE PTR [DI], '-'\n\
+\tINC DI\n\
+\tNEG DX\n\
 \tNEG AX\n\
-\tJMP PRINT\n\
+\tSBB DX, 0\n\
+PRINT_DIGITS:\n\
+\tMOV SI, OFFSET NUMBER+10\n\
+\tMOV CX, 100\n\
+PRINT_PAIR:\n\
+\tMOV BX, AX\n\
+\tMOV AX, DX\n\
+\tXOR DX, DX\n\
+\tDIV CX\n\
+\tXCHG AX, BX\n\
+\tDIV CX\n\
+\tXCHG DX, BX\n\
+\tSHL BX, 1\n\
+\tMOV BX, WORD PTR DIGITS[BX]\n\
+\tSUB SI, 2\n\
+\tMOV [SI], BX\n\
+\tMOV BX, AX\n\
+\tOR BX, DX\n\
+\tJNZ PRINT_PAIR\n\
+\tCMP BYTE PTR [SI], '0'\n\
+\tJNE PRINT_COPY\n\
+\tINC SI\n\
+PRINT_COPY:\n\
+\tMOV CX, OFFSET NUMBER+10\n\
+\tSUB CX, SI\n\
+\tCLD\n\
+\tREP MOVSB\n\
+\tSUB DI, OFFSET OUTPUT_BUFFER\n\
+\tMOV OUTPUT_LENGTH, DI\n\
+\tPOP DI\n\
+\tPOP SI\n\
+\tPOP DX\n\
+\tPOP CX\n\
+\tPOP BX\n\
+\tPOP AX\n\
+\tRET\n\
 print_output ENDP\n";
 
+// signed DX:AX / CX:BX, the quotient is left in DX:AX and the remainder in CX:BX
+// both are divided as unsigned, bit 0 of SI is the sign of the quotient, bit 1 the sign of the remainder
+// a divisor below 65536 takes two DIVs, a larger one 32 steps of shift and subtract
+string div32Proc =
+    "div32 PROC\n\
+\tPUSH SI\n\
+\tPUSH DI\n\
+\tPUSH BP\n\
+\tXOR SI, SI\n\
+\tCMP DX, 0\n\
+\tJGE DIV32_DIVIDEND\n\
+\tNEG DX\n\
+\tNEG AX\n\
+\tSBB DX, 0\n\
+\tMOV SI, 3\n\
+DIV32_DIVIDEND:\n\
+\tCMP CX, 0\n\
+\tJGE DIV32_DIVISOR\n\
+\tNEG CX\n\
+\tNEG BX\n\
+\tSBB CX, 0\n\
+\tXOR SI, 1\n\
+DIV32_DIVISOR:\n\
+\tJCXZ DIV32_SHORT\n\
+\tPUSH SI\n\
+\tXOR DI, DI\n\
+\tXOR BP, BP\n\
+\tMOV SI, 32\n\
+DIV32_STEP:\n\
+\tSHL AX, 1\n\
+\tRCL DX, 1\n\
+\tRCL BP, 1\n\
+\tRCL DI, 1\n\
+\tCMP DI, CX\n\
+\tJB DIV32_NEXT\n\
+\tJA DIV32_SUBTRACT\n\
+\tCMP BP, BX\n\
+\tJB DIV32_NEXT\n\
+DIV32_SUBTRACT:\n\
+\tSUB BP, BX\n\
+\tSBB DI, CX\n\
+\tINC AX\n\
+DIV32_NEXT:\n\
+\tDEC SI\n\
+\tJNZ DIV32_STEP\n\
+\tMOV BX, BP\n\
+\tMOV CX, DI\n\
+\tPOP SI\n\
+\tJMP DIV32_SIGNS\n\
+DIV32_SHORT:\n\
+\tMOV CX, AX\n\
+\tMOV AX, DX\n\
+\tXOR DX, DX\n\
+\tDIV BX\n\
+\tXCHG AX, CX\n\
+\tDIV BX\n\
+\tMOV BX, DX\n\
+\tMOV DX, CX\n\
+\tXOR CX, CX\n\
+DIV32_SIGNS:\n\
+\tTEST SI, 1\n\
+\tJZ DIV32_REMAINDER\n\
+\tNEG DX\n\
+\tNEG AX\n\
+\tSBB DX, 0\n\
+DIV32_REMAINDER:\n\
+\tTEST SI, 2\n\
+\tJZ DIV32_DONE\n\
+\tNEG CX\n\
+\tNEG BX\n\
+\tSBB CX, 0\n\
+DIV32_DONE:\n\
+\tPOP BP\n\
+\tPOP DI\n\
+\tPOP SI\n\
+\tRET\n\
+div32 ENDP\n";
+
 void preOrderParaseTree(SymbolInfo* head);
+void printParseTree(SymbolInfo* head);
 void generateCode(SymbolInfo* head);
 bool matchRule(SymbolInfo* head, string rule);
 void trim(string& s);
 void printLabel(int label);
 int newLabel();
 void printCode(string s);
+string labelName(int label);
+string lineName(int line);
+void generateProgram(SymbolInfo* program);
 void printJump(string jump, int label);
 void printMovBpAx(SymbolInfo* var);
 void printMovAxBp(SymbolInfo* var);
 
 void preOrderParaseTree(SymbolInfo* head) {
-    fprintf(parseTreeOut, head->printNode().c_str());
-    for (auto child : head->getChildren()) {
-        child->setDepth(head->getDepth() + 1);
-        preOrderParaseTree(child);
+    // the tree is printed once parsing is done
+    compilerStats.endParse();
+    PhaseTimer timer(PHASE_PARSE_TREE);
+    printParseTree(head);
+
+    const char* astOutput = getenv("AST_OUTPUT");
+    if (astOutput != NULL && !writeAst(head, globalVarInfo, astOutput)) {
+        fprintf(stderr, "Cannot write the AST to %s\n", astOutput);
+    }
+}
+
+// pre-order with an explicit stack, list chains are as deep as the list is long
+void printParseTree(SymbolInfo* head) {
+    vector<pair<SymbolInfo*, int>> stack = {{head, head->getDepth()}};
+    while (!stack.empty()) {
+        SymbolInfo* node = stack.back().first;
+        // uses of a variable share its node, the depth is set when it is printed
+        node->setDepth(stack.back().second);
+        stack.pop_back();
+
+        fputs(node->printNode().c_str(), parseTreeOut);
+        auto children = node->getChildren();
+        for (auto it = children.rbegin(); it != children.rend(); it++) {
+            stack.push_back({*it, node->getDepth() + 1});
+        }
     }
 }
 
@@ -116,88 +396,985 @@ bool isGlobalVar(SymbolInfo* var) {
 }
 
 void printCode(string s) {
-    fprintf(assemblyCodeOut, s.c_str());
+    if (codeBuffer != nullptr) {
+        codeBuffer->append(s);
+    } else {
+        compilerStats.countInstructions(s.c_str());
+        fputs(s.c_str(), assemblyCodeOut);
+    }
+}
+
+string labelName(int label) {
+    if (functionLabelCount != nullptr) {
+        // function relative, rebased in writeFunction
+        return string(1, LABEL_MARK) + to_string(label) + MARK_END;
+    }
+    return "L" + to_string(label);
+}
+
+string lineName(int line) {
+    if (functionLabelCount != nullptr) {
+        return string(1, LINE_MARK) + to_string(line - functionStartLine) + MARK_END;
+    }
+    return to_string(line);
 }
 
 void printLabel(int label = -1) {
     if (label == -1)
-        printCode("L" + to_string(newLabel()) + ":\n");
+        printCode(labelName(newLabel()) + ":\n");
     else
-        printCode("L" + to_string(label) + ":\n");
+        printCode(labelName(label) + ":\n");
 }
 
 void printJump(string jump, int label) {
-    printCode("\t" + jump + " L" + to_string(label) + "\n");
+    printCode("\t" + jump + " " + labelName(label) + "\n");
 }
 
-void printMovBpAx(SymbolInfo* var) {
-    if (var->stackBuffer > 0) {
-        printCode("\tMOV [BP-" + to_string(var->stackBuffer) + "], AX\n");
+// CODEGEN_INT32 makes int 32 bits wide: a value is kept in DX:AX, variables are DD and locals,
+// parameters and array elements take 4 bytes, the low word first
+// cost model: where only the low word of a value is used, it is computed in AX alone
+// (narrowValues), as is an operation whose values provably fit in 16 bits (valueRange), which is
+// sign extended into DX; a value that can only be 0 or 1 is tested without DX
+bool int32Mode() {
+    static const bool mode = getenv("CODEGEN_INT32") != NULL && strcmp(getenv("CODEGEN_INT32"), "0") != 0;
+    return mode;
+}
+
+// whether the value being generated fills DX:AX
+bool wideValue() {
+    return int32Mode() && !narrowValues;
+}
+
+// bytes of an int variable, parameter or array element
+int intSize() {
+    return int32Mode() ? 4 : 2;
+}
+
+// whether an expression is a comparison, a logic operation or a negation, whose value is 0 or 1 in AX
+bool isBoolean(SymbolInfo* expression) {
+    for (SymbolInfo* node = expression; !node->isLeaf();) {
+        auto children = node->getChildren();
+        if (matchRule(node, "rel_expression : simple_expression RELOP simple_expression") || matchRule(node, "logic_expression : rel_expression LOGICOP rel_expression") || matchRule(node, "unary_expression : NOT unary_expression")) {
+            return true;
+        } else if (matchRule(node, "factor : LPAREN expression RPAREN")) {
+            node = children[1];
+        } else if (matchRule(node, "expression_statement : expression SEMICOLON") || children.size() == 1) {
+            node = children[0];
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+// whether an array index can be computed in AX alone: the low word of +, - and * depends only on
+// the low words of the operands, and reads, constants and negation need no high word either
+bool narrowIndex(SymbolInfo* index) {
+    vector<SymbolInfo*> stack = {index};
+    while (!stack.empty()) {
+        SymbolInfo* node = stack.back();
+        stack.pop_back();
+        if (node->isLeaf()) continue;
+        auto children = node->getChildren();
+        if (matchRule(node, "term : term MULOP unary_expression") && children[1]->getName() != "*") return false;
+        if (matchRule(node, "expression : variable ASSIGNOP logic_expression") || matchRule(node, "factor : variable INCOP") || matchRule(node, "factor : variable DECOP") || isBoolean(node)) return false;
+        if (matchRule(node, "factor : ID LPAREN argument_list RPAREN") || matchRule(node, "factor : ID LPAREN RPAREN")) return false;
+        stack.insert(stack.end(), children.begin(), children.end());
+    }
+    return true;
+}
+
+// the counter of an enclosing for loop and the values it takes, see loopCounter
+thread_local map<SymbolInfo*, pair<long long, long long>> loopCounters;
+
+// what is known of the value of an expression
+struct ValueRange {
+    bool known = false;  // lo <= value <= hi
+    long long lo = 0;
+    long long hi = 0;
+    bool narrow = false;  // computed in AX alone: every value on the way fits in 16 bits
+
+    bool small() const { return known && lo >= -32768 && hi <= 32767; }
+};
+
+thread_local unordered_map<SymbolInfo*, ValueRange> valueRanges;
+
+// a range outside of 32 bits wraps around, nothing is known of it
+ValueRange boundedRange(long long lo, long long hi) {
+    ValueRange range;
+    if (lo < INT32_MIN || hi > INT32_MAX) return range;
+    range.known = true;
+    range.lo = lo;
+    range.hi = hi;
+    return range;
+}
+
+// the value of an integer literal, false when it does not fit in a long long
+bool literalValue(const string& text, long long& value) {
+    errno = 0;
+    char* end;
+    value = strtoll(text.c_str(), &end, 10);
+    return errno != ERANGE && *end == '\0';
+}
+
+// the low 32 bits of an integer literal however long it is, as a 32 bit int wraps it
+uint32_t literalBits(const string& text) {
+    uint32_t bits = 0;
+    for (char c : text) bits = bits * 10 + (c - '0');
+    return bits;
+}
+
+// the node under a chain of single, non leaf children
+SymbolInfo* innerNode(SymbolInfo* node) {
+    while (!node->isLeaf() && node->getChildren().size() == 1 && !node->getChildren()[0]->isLeaf()) {
+        node = node->getChildren()[0];
+    }
+    return node;
+}
+
+// whether expression is a constant, which is left in value
+bool constantValue(SymbolInfo* expression, long long& value) {
+    SymbolInfo* node = innerNode(expression);
+    if (!matchRule(node, "factor : CONST_INT")) return false;
+    return literalValue(node->getChildren()[0]->getName(), value);
+}
+
+// the scalar variable expression reads, nullptr if it does more than that
+SymbolInfo* readVariable(SymbolInfo* expression) {
+    SymbolInfo* node = innerNode(expression);
+    if (!matchRule(node, "variable : ID") || node->getChildren()[0]->isArray()) return nullptr;
+    return node->getChildren()[0];
+}
+
+// the range of a node from the ranges of its children, see valueRange
+ValueRange nodeRange(SymbolInfo* node) {
+    auto children = node->getChildren();
+    ValueRange range;
+    if (matchRule(node, "factor : CONST_INT")) {
+        // a literal too long for a long long has an unknown range
+        long long value;
+        if (literalValue(children[0]->getName(), value)) range = boundedRange(value, value);
+        range.narrow = range.small();
+    } else if (matchRule(node, "factor : variable")) {
+        // a local, or a parameter, the loop does not assign: nothing else can
+        SymbolInfo* var = readVariable(children[0]);
+        if (var != nullptr && loopCounters.count(var)) {
+            range = boundedRange(loopCounters[var].first, loopCounters[var].second);
+            range.narrow = range.small();
+        }
+    } else if (matchRule(node, "factor : LPAREN expression RPAREN")) {
+        range = valueRanges[children[1]];
+    } else if (matchRule(node, "unary_expression : ADDOP unary_expression")) {
+        ValueRange operand = valueRanges[children[1]];
+        if (operand.known) range = children[0]->getName() == "-" ? boundedRange(-operand.hi, -operand.lo) : operand;
+        range.narrow = operand.small() && range.small();
+    } else if (matchRule(node, "unary_expression : NOT unary_expression")) {
+        range = boundedRange(0, 1);
+        range.narrow = valueRanges[children[1]].small();
+    } else if (matchRule(node, "rel_expression : simple_expression RELOP simple_expression") || matchRule(node, "logic_expression : rel_expression LOGICOP rel_expression")) {
+        range = boundedRange(0, 1);
+        range.narrow = valueRanges[children[0]].small() && valueRanges[children[2]].small();
+    } else if (matchRule(node, "simple_expression : simple_expression ADDOP term") || matchRule(node, "term : term MULOP unary_expression")) {
+        // a link of a chain is generated with the chain, the first operand is generated on its own
+        ValueRange left = valueRanges[children[0]];
+        ValueRange right = valueRanges[children[2]];
+        bool chained = matchRule(children[0], "simple_expression : simple_expression ADDOP term") || matchRule(children[0], "term : term MULOP unary_expression");
+        bool operands = (chained ? left.narrow : left.small()) && right.small();
+        string op = children[1]->getName();
+        bool divisor = right.known && (right.lo > 0 || right.hi < 0);
+        if (op == "%" && divisor) {
+            // the remainder is smaller than the divisor and has the sign of the dividend
+            long long most = max(llabs(right.lo), llabs(right.hi)) - 1;
+            range = left.known && left.lo >= 0 ? boundedRange(0, min(left.hi, most)) : boundedRange(-most, most);
+        } else if (op == "/" && divisor && left.known) {
+            long long most = max(llabs(left.lo), llabs(left.hi)) / min(llabs(right.lo), llabs(right.hi));
+            range = left.lo >= 0 && right.lo > 0 ? boundedRange(left.lo / right.hi, left.hi / right.lo) : boundedRange(-most, most);
+        } else if (op == "*" && left.known && right.known) {
+            long long products[] = {left.lo * right.lo, left.lo * right.hi, left.hi * right.lo, left.hi * right.hi};
+            range = boundedRange(*min_element(products, products + 4), *max_element(products, products + 4));
+        } else if (op == "+" && left.known && right.known) {
+            range = boundedRange(left.lo + right.lo, left.hi + right.hi);
+        } else if (op == "-" && left.known && right.known) {
+            range = boundedRange(left.lo - right.hi, left.hi - right.lo);
+        }
+        // the 16 bit division is unsigned
+        if (op == "/" || op == "%") operands = operands && left.lo >= 0 && right.lo > 0;
+        range.narrow = operands && range.small();
+    } else if (children.size() == 1 && !children[0]->isLeaf()) {
+        range = valueRanges[children[0]];
+    }
+    return range;
+}
+
+// the range of an expression, bottom up with an explicit stack; calls, assignments, increments and
+// array elements are not followed, nothing is known of their values
+ValueRange valueRange(SymbolInfo* expression) {
+    vector<pair<SymbolInfo*, bool>> stack = {{expression, false}};
+    while (!stack.empty()) {
+        SymbolInfo* node = stack.back().first;
+        if (valueRanges.count(node)) {
+            stack.pop_back();
+        } else if (!stack.back().second) {
+            stack.back().second = true;
+            for (auto child : node->getChildren()) {
+                if (!child->isLeaf()) stack.push_back({child, false});
+            }
+        } else {
+            stack.pop_back();
+            valueRanges[node] = nodeRange(node);
+        }
+    }
+    return valueRanges[expression];
+}
+
+// the operations a value range decides the width of
+bool isOperation(SymbolInfo* node) {
+    return matchRule(node, "simple_expression : simple_expression ADDOP term") || matchRule(node, "term : term MULOP unary_expression") || matchRule(node, "rel_expression : simple_expression RELOP simple_expression") || matchRule(node, "logic_expression : rel_expression LOGICOP rel_expression") || matchRule(node, "unary_expression : ADDOP unary_expression") || matchRule(node, "unary_expression : NOT unary_expression");
+}
+
+// whether a statement assigns, increments or decrements var
+bool assigns(SymbolInfo* statement, SymbolInfo* var) {
+    vector<SymbolInfo*> stack = {statement};
+    while (!stack.empty()) {
+        SymbolInfo* node = stack.back();
+        stack.pop_back();
+        if (node->isLeaf()) continue;
+        auto children = node->getChildren();
+        if (matchRule(node, "expression : variable ASSIGNOP logic_expression") || matchRule(node, "factor : variable INCOP") || matchRule(node, "factor : variable DECOP")) {
+            if (children[0]->getChildren()[0] == var) return true;
+        }
+        stack.insert(stack.end(), children.begin(), children.end());
+    }
+    return false;
+}
+
+// for (i = a; i < b; i++) and for (i = a; i > b; i--), with <= and >= too, on a local i the body
+// does not assign: the values i takes in the loop, its condition and its step, nullptr otherwise
+SymbolInfo* loopCounter(SymbolInfo* loop, long long& lo, long long& hi) {
+    auto children = loop->getChildren();
+    SymbolInfo* init = innerNode(children[2]);
+    SymbolInfo* condition = innerNode(children[3]);
+    SymbolInfo* step = innerNode(children[4]);
+    if (!matchRule(init, "expression : variable ASSIGNOP logic_expression") || !matchRule(condition, "rel_expression : simple_expression RELOP simple_expression")) return nullptr;
+    if (!matchRule(step, "factor : variable INCOP") && !matchRule(step, "factor : variable DECOP")) return nullptr;
+
+    SymbolInfo* var = readVariable(init->getChildren()[0]);
+    long long first, bound;
+    if (var == nullptr || isGlobalVar(var) || !constantValue(init->getChildren()[2], first)) return nullptr;
+    if (readVariable(condition->getChildren()[0]) != var || !constantValue(condition->getChildren()[2], bound)) return nullptr;
+    if (step->getChildren()[0]->getChildren()[0] != var || assigns(children[6], var)) return nullptr;
+
+    string op = condition->getChildren()[1]->getName();
+    if (matchRule(step, "factor : variable INCOP") && (op == "<" || op == "<=")) {
+        lo = first;
+        hi = max(first, op == "<" ? bound : bound + 1);
+    } else if (matchRule(step, "factor : variable DECOP") && (op == ">" || op == ">=")) {
+        lo = min(first, op == ">" ? bound : bound - 1);
+        hi = first;
     } else {
-        printCode("\tMOV [BP+" + to_string(-var->stackBuffer) + "], AX\n");
+        return nullptr;
     }
+    return var;
+}
+
+// a word of a local or a parameter, word 1 is the high word of a 32 bit int
+string stackOperand(SymbolInfo* var, int word = 0) {
+    if (var->registerName != "") return var->registerName;
+    if (var->stackBuffer > 0) return "[BP-" + to_string(var->stackBuffer - 2 * word) + "]";
+    return "[BP+" + to_string(-var->stackBuffer + 2 * word) + "]";
+}
+
+// a word of a global int, the DD of a 32 bit int is read a word at a time
+string globalOperand(SymbolInfo* var, int word = 0) {
+    if (!int32Mode()) return var->getName();
+    return "WORD PTR " + var->getName() + (word == 1 ? "+2" : "");
+}
+
+// a word of the element BX indexes, BX is the offset into a global array or the element's address
+string elementOperand(SymbolInfo* var, int word = 0) {
+    string address = isGlobalVar(var) ? var->getName() + "+BX" : "BX";
+    if (word == 1) address += "+2";
+    if (!int32Mode()) return "[" + address + "]";
+    return "WORD PTR [" + address + "]";
+}
+
+void printMovBpAx(SymbolInfo* var) {
+    printCode("\tMOV " + stackOperand(var) + ", AX\n");
 }
 
 void printMovAxBp(SymbolInfo* var) {
-    if (var->stackBuffer > 0) {
-        printCode("\tMOV AX, [BP-" + to_string(var->stackBuffer) + "]\n");
+    printCode("\tMOV AX, " + stackOperand(var) + "\n");
+}
+
+// a scalar variable into AX, and its high word into DX for a 32 bit value
+void printLoad(SymbolInfo* var) {
+    if (isGlobalVar(var)) {
+        printCode("\tMOV AX, " + globalOperand(var) + "\n");
+        if (wideValue()) printCode("\tMOV DX, " + globalOperand(var, 1) + "\n");
+    } else {
+        printMovAxBp(var);
+        if (wideValue()) printCode("\tMOV DX, " + stackOperand(var, 1) + "\n");
+    }
+}
+
+void printStore(SymbolInfo* var) {
+    if (isGlobalVar(var)) {
+        printCode("\tMOV " + globalOperand(var) + ", AX\n");
+        if (wideValue()) printCode("\tMOV " + globalOperand(var, 1) + ", DX\n");
     } else {
-        printCode("\tMOV AX, [BP+" + to_string(-var->stackBuffer) + "]\n");
+        printMovBpAx(var);
+        if (wideValue()) printCode("\tMOV " + stackOperand(var, 1) + ", DX\n");
     }
 }
 
-int newLabel() { return labelCount++; }
+void printLoadElement(SymbolInfo* var) {
+    printCode("\tMOV AX, " + elementOperand(var) + "\n");
+    if (wideValue()) printCode("\tMOV DX, " + elementOperand(var, 1) + "\n");
+}
 
-void generateCode(SymbolInfo* head) {
+void printStoreElement(SymbolInfo* var) {
+    printCode("\tMOV " + elementOperand(var) + ", AX\n");
+    if (wideValue()) printCode("\tMOV " + elementOperand(var, 1) + ", DX\n");
+}
+
+// the value is kept on the stack while another one is generated, the high word below
+void printPushValue() {
+    if (wideValue()) printCode("\tPUSH DX\n");
+    printCode("\tPUSH AX\n");
+}
+
+void printPopValue() {
+    printCode("\tPOP AX\n");
+    if (wideValue()) printCode("\tPOP DX\n");
+}
+
+// a 32 bit right operand goes to CX:BX and the pushed left one back to DX:AX
+void printWideOperands() {
+    printCode("\tMOV BX, AX\n\tMOV CX, DX\n\tPOP AX\n\tPOP DX\n");
+}
+
+// pushes the argument in AX, or the 32 bit one in DX:AX
+void printPushArgument() {
+    if (wideValue()) {
+        printCode("\tPUSH DX\n\tPUSH AX\n");
+    } else {
+        printCode("\tMOV BX, AX\n\tPUSH BX\n");
+    }
+}
+
+// x++ or x-- on a 32 bit int: the old value is loaded into DX:AX and the variable is stepped in place
+void printWideStep(SymbolInfo* variable, string step, string carry) {
+    SymbolInfo* var = variable->getChildren()[0];
+    if (var->isArray()) generateLater(variable);
+    printLater([=]() {
+        string low, high;
+        if (var->isArray()) {
+            low = elementOperand(var);
+            high = elementOperand(var, 1);
+        } else if (isGlobalVar(var)) {
+            low = globalOperand(var);
+            high = globalOperand(var, 1);
+        } else {
+            low = "WORD PTR " + stackOperand(var);
+            high = "WORD PTR " + stackOperand(var, 1);
+        }
+        printCode("\tMOV AX, " + low + "\n\tMOV DX, " + high + "\n");
+        printCode("\t" + step + " " + low + ", 1\n\t" + carry + " " + high + ", 0\n");
+    });
+}
+
+// sets ZF when the value of expression is 0, AX is not kept
+void printTestValue(SymbolInfo* expression) {
+    if (wideValue() && !isBoolean(expression)) {
+        printCode("\tOR AX, DX\n");
+    } else {
+        printCode("\tCMP AX, 0\n");
+    }
+}
+
+// arrays are passed by the address of their first element, elements are at ascending addresses
+// an array parameter has no size, it holds the address; a local array starts at BP - stackBuffer
+void printArrayAddress(SymbolInfo* var) {
+    if (isGlobalVar(var)) {
+        printCode("\tMOV AX, OFFSET " + var->getName() + "\n");
+    } else if (var->getSize() == 0) {
+        printMovAxBp(var);
+    } else {
+        printCode("\tMOV AX, BP\n\tSUB AX, " + to_string(var->stackBuffer) + "\n");
+    }
+}
+
+// CODEGEN_FASTCALL selects the register convention: "*" for every function but main,
+// or a comma separated list of function names
+// the first arguments are passed in fastcallRegisters, the rest are pushed as before
+const vector<string> fastcallRegisters = {"SI", "DI"};
+const vector<string> callRules = {"factor : ID LPAREN argument_list RPAREN", "factor : ID LPAREN RPAREN"};
+
+string fastcallSetting() {
+    static const string setting = getenv("CODEGEN_FASTCALL") != NULL ? getenv("CODEGEN_FASTCALL") : "";
+    return setting;
+}
+
+// with 32 bit ints a register pair per argument would leave no scratch registers, everything is pushed
+bool isFastcall(const string& name) {
+    string setting = fastcallSetting();
+    if (setting.empty() || name == "main" || int32Mode()) return false;
+    return setting == "*" || ("," + setting + ",").find("," + name + ",") != string::npos;
+}
+
+// the parser of this stage builds a list (program, statements, parameter_list, arguments) as a
+// left nested chain with one node per item, unlike the flat list nodes of the stage 3 parser,
+// so the list walkers below and in generateCode follow getChildren()[0] down the chain in a loop
+
+// the logic_expressions of an argument_list, first argument first
+vector<SymbolInfo*> argumentExpressions(SymbolInfo* argumentList) {
+    vector<SymbolInfo*> arguments;
+    SymbolInfo* node = argumentList->getChildren()[0];
+    for (; matchRule(node, "arguments : arguments COMMA logic_expression"); node = node->getChildren()[0]) {
+        arguments.push_back(node->getChildren()[2]);
+    }
+    arguments.push_back(node->getChildren()[0]);
+    reverse(arguments.begin(), arguments.end());
+    return arguments;
+}
+
+// whether any node under head matches one of the rules
+bool containsRule(SymbolInfo* head, const vector<string>& rules) {
+    vector<SymbolInfo*> stack = {head};
+    while (!stack.empty()) {
+        SymbolInfo* node = stack.back();
+        stack.pop_back();
+        if (node->isLeaf()) continue;
+        for (auto& rule : rules) {
+            if (matchRule(node, rule)) return true;
+        }
+        auto children = node->getChildren();
+        stack.insert(stack.end(), children.begin(), children.end());
+    }
+    return false;
+}
+
+// the IDs of a parameter_list chain, first parameter first
+vector<SymbolInfo*> parameterIds(SymbolInfo* parameterList) {
+    vector<SymbolInfo*> ids;
+    for (SymbolInfo* node = parameterList; node != nullptr;) {
+        auto children = node->getChildren();
+        for (auto child : children) {
+            if (child->getSType() == "ID") {
+                ids.push_back(child);
+                break;
+            }
+        }
+        node = children[0]->getSType() == "parameter_list" ? children[0] : nullptr;
+    }
+    reverse(ids.begin(), ids.end());
+    return ids;
+}
+
+int newLabel() {
+    if (functionLabelCount != nullptr) return (*functionLabelCount)++;
+    compilerStats.labels++;
+    return labelCount++;
+}
+
+// writes a function generated by a worker, numbering its labels after the ones already used
+void writeFunction(const string& code, int labels, int startLine) {
+    string out;
+    out.reserve(code.size());
+
+    for (size_t i = 0; i < code.size(); i++) {
+        if (code[i] != LABEL_MARK && code[i] != LINE_MARK) {
+            out += code[i];
+            continue;
+        }
+        size_t end = code.find(MARK_END, i);
+        int n = stoi(code.substr(i + 1, end - i - 1));
+        if (code[i] == LABEL_MARK) {
+            out += "L" + to_string(labelCount + n);
+        } else {
+            out += to_string(startLine + n);
+        }
+        i = end;
+    }
+
+    compilerStats.countInstructions(out.c_str());
+    fputs(out.c_str(), assemblyCodeOut);
+    labelCount += labels;
+    compilerStats.labels += labels;
+}
+
+// the units of program : program unit | unit, in source order
+vector<SymbolInfo*> programUnits(SymbolInfo* program) {
+    vector<SymbolInfo*> units;
+    while (matchRule(program, "program : program unit")) {
+        units.push_back(program->getChildren()[1]);
+        program = program->getChildren()[0];
+    }
+    units.push_back(program->getChildren()[0]);
+    reverse(units.begin(), units.end());
+    return units;
+}
+
+// the func_definition units reachable from main through calls, only these are generated,
+// and whether any of them prints or divides, otherwise that part of the runtime is left out
+// a program without main keeps every function
+set<SymbolInfo*> reachableFunctions;
+bool outputUsed = true;
+bool divisionUsed = true;
+
+void findReachable(SymbolInfo* program) {
+    map<string, SymbolInfo*> definitions;
+    for (auto unit : programUnits(program)) {
+        if (matchRule(unit, "unit : func_definition")) definitions[unit->getChildren()[0]->getChildren()[1]->getName()] = unit;
+    }
+
+    reachableFunctions.clear();
+    outputUsed = true;
+    divisionUsed = true;
+    if (!definitions.count("main")) {
+        for (auto& definition : definitions) reachableFunctions.insert(definition.second);
+        return;
+    }
+
+    outputUsed = false;
+    divisionUsed = false;
+    vector<SymbolInfo*> work = {definitions["main"]};
+    reachableFunctions.insert(definitions["main"]);
+    while (!work.empty()) {
+        vector<SymbolInfo*> stack = {work.back()};
+        work.pop_back();
+        while (!stack.empty()) {
+            SymbolInfo* node = stack.back();
+            stack.pop_back();
+            if (node->isLeaf()) continue;
+            if (matchRule(node, "statement : PRINTLN LPAREN ID RPAREN SEMICOLON")) outputUsed = true;
+            if (matchRule(node, "term : term MULOP unary_expression") && node->getChildren()[1]->getName() != "*") divisionUsed = true;
+            for (auto& rule : callRules) {
+                if (!matchRule(node, rule)) continue;
+                auto callee = definitions.find(node->getChildren()[0]->getName());
+                if (callee != definitions.end() && reachableFunctions.insert(callee->second).second) work.push_back(callee->second);
+            }
+            auto children = node->getChildren();
+            stack.insert(stack.end(), children.begin(), children.end());
+        }
+    }
+}
+
+// cache of generated functions, kept in the CODEGEN_CACHE directory when it is set
+// a function is keyed by its subtree (rules, lexemes and lines relative to the function)
+// and the globals it uses, an entry holds the label count and the code with relative labels and lines
+// only code generation is cached: lexing, parsing and the semantic checks in the parser
+// actions run on every compile, so diagnostics always come from the current run
+
+uint64_t hashString(uint64_t hash, const string& s) {
+    for (unsigned char c : s) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// the compiler binary, so that the code of another build of the generator is never reused
+// the binary is identified by its inode, size and modification time rather than its contents,
+// taken once per process and only when the cache is in use
+// a binary that cannot be found falls back to the build time
+uint64_t compilerHash() {
+    static const uint64_t hash = []() {
+        struct stat binary;
+        if (stat("/proc/self/exe", &binary) != 0) return hashString(14695981039346656037ULL, __DATE__ " " __TIME__);
+        return hashString(14695981039346656037ULL, to_string(binary.st_dev) + " " + to_string(binary.st_ino) + " " +
+                                                       to_string(binary.st_size) + " " + to_string(binary.st_mtim.tv_sec) +
+                                                       "." + to_string(binary.st_mtim.tv_nsec));
+    }();
+    return hash;
+}
+
+string hashFunction(SymbolInfo* function, const set<SymbolInfo*>& globals) {
+    uint64_t hash = compilerHash();
+    // the convention of the function and of the ones it calls
+    if (!fastcallSetting().empty()) hash = hashString(hash, "fastcall " + fastcallSetting() + "\n");
+    if (int32Mode()) hash = hashString(hash, "int32\n");
+    // main flushes the output when it exits
+    hash = hashString(hash, outputUsed ? "output\n" : "no output\n");
+    int startLine = function->getStartLine();
+
+    vector<SymbolInfo*> stack = {function};
+    while (!stack.empty()) {
+        SymbolInfo* node = stack.back();
+        stack.pop_back();
+
+        auto children = node->getChildren();
+        string key = node->getSType() + " " + to_string(children.size());
+        if (node->isLeaf()) key += " " + node->getName();
+        if (globals.count(node)) {
+            // uses of a global are linked to its declaration, outside the function
+            key += " global " + to_string(node->isArray());
+        } else {
+            key += " " + to_string(node->getStartLine() - startLine) + " " + to_string(node->getEndLine() - startLine);
+        }
+        hash = hashString(hash, key + "\n");
+
+        for (auto it = children.rbegin(); it != children.rend(); it++) stack.push_back(*it);
+    }
+
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+    return name;
+}
+
+bool readCachedFunction(string path, string& code, int& labels) {
+    ifstream in(path, ios::binary);
+    if (!(in >> labels) || in.get() != '\n') return false;
+    stringstream buffer;
+    buffer << in.rdbuf();
+    code = buffer.str();
+    return true;
+}
+
+void writeCachedFunction(string path, const string& code, int labels) {
+    // written under a name of this process and thread and renamed, so readers never see a partial entry
+    // (compilers run by the batch driver share the directory)
+    string temp = path + "." + to_string(getpid()) + "." + to_string(hash<thread::id>()(this_thread::get_id())) + ".tmp";
+    ofstream out(temp, ios::binary);
+    out << labels << "\n"
+        << code;
+    out.close();
+    if (!out || rename(temp.c_str(), path.c_str()) != 0) remove(temp.c_str());
+}
+
+// program : program unit | unit
+// declarations are handled in order on this thread (they only assign global offsets),
+// function definitions are generated on CODEGEN_THREADS workers (default: all cores)
+void generateProgram(SymbolInfo* program) {
+    vector<SymbolInfo*> functions;
+    for (auto unit : programUnits(program)) {
+        if (matchRule(unit, "unit : func_definition")) {
+            if (reachableFunctions.count(unit)) functions.push_back(unit);
+        } else {
+            generateCode(unit);
+        }
+    }
+
+    int threads = thread::hardware_concurrency();
+    if (getenv("CODEGEN_THREADS") != NULL) threads = atoi(getenv("CODEGEN_THREADS"));
+    threads = max(1, min(threads, (int)functions.size()));
+
+    const char* cacheDir = getenv("CODEGEN_CACHE");
+    auto globalVars = globalVarInfo->getDeclarations();
+    set<SymbolInfo*> globals(globalVars.begin(), globalVars.end());
+
+    vector<string> codes(functions.size());
+    vector<int> labels(functions.size(), 0);
+    atomic<int> next(0);
+
+    auto worker = [&]() {
+        for (int i = next++; i < (int)functions.size(); i = next++) {
+            string cachePath;
+            if (cacheDir != NULL) {
+                cachePath = string(cacheDir) + "/" + hashFunction(functions[i], globals) + ".asm";
+                if (readCachedFunction(cachePath, codes[i], labels[i])) continue;
+            }
+
+            codeBuffer = &codes[i];
+            functionLabelCount = &labels[i];
+            functionStartLine = functions[i]->getStartLine();
+            generateCode(functions[i]);
+            codeBuffer = nullptr;
+            functionLabelCount = nullptr;
+
+            if (cacheDir != NULL) writeCachedFunction(cachePath, codes[i], labels[i]);
+        }
+    };
+
+    vector<thread> pool;
+    for (int i = 1; i < threads; i++) pool.push_back(thread(worker));
+    worker();
+    for (auto& t : pool) t.join();
+
+    for (int i = 0; i < (int)functions.size(); i++) {
+        writeFunction(codes[i], labels[i], functions[i]->getStartLine());
+    }
+}
+
+// the call a returned expression ends in, nullptr if the expression does more than a call
+SymbolInfo* tailCall(SymbolInfo* expression) {
+    for (SymbolInfo* node = expression;;) {
+        auto children = node->getChildren();
+        if (matchRule(node, "factor : ID LPAREN argument_list RPAREN") || matchRule(node, "factor : ID LPAREN RPAREN")) {
+            return node;
+        } else if (matchRule(node, "factor : LPAREN expression RPAREN")) {
+            node = children[1];
+        } else if (children.size() == 1 && !node->isLeaf()) {
+            node = children[0];
+        } else {
+            return nullptr;
+        }
+    }
+}
+
+// whether a return statement in body calls the function itself
+bool hasSelfTailCall(SymbolInfo* body, const string& name) {
+    vector<SymbolInfo*> stack = {body};
+    while (!stack.empty()) {
+        SymbolInfo* node = stack.back();
+        stack.pop_back();
+        if (node->isLeaf()) continue;
+        if (matchRule(node, "statement : RETURN expression SEMICOLON")) {
+            SymbolInfo* call = tailCall(node->getChildren()[1]);
+            if (call != nullptr && call->getChildren()[0]->getName() == name) return true;
+            continue;
+        }
+        auto children = node->getChildren();
+        stack.insert(stack.end(), children.begin(), children.end());
+    }
+    return false;
+}
+
+// whether an argument is the address of a local array, which does not outlive the frame
+bool passesLocalArray(const vector<SymbolInfo*>& arguments) {
+    vector<SymbolInfo*> stack(arguments.begin(), arguments.end());
+    while (!stack.empty()) {
+        SymbolInfo* node = stack.back();
+        stack.pop_back();
+        if (node->isLeaf()) continue;
+        if (matchRule(node, "factor : variable") && matchRule(node->getChildren()[0], "variable : ID")) {
+            SymbolInfo* var = node->getChildren()[0]->getChildren()[0];
+            if (var->isArray() && var->getSize() > 0 && !isGlobalVar(var)) return true;
+        }
+        auto children = node->getChildren();
+        stack.insert(stack.end(), children.begin(), children.end());
+    }
+    return false;
+}
+
+// return f(...) without a CALL: a call of the function itself rewrites the parameters and jumps to
+// functionEntryLabel, another function gets its pushed arguments in the words this function's
+// caller pushed, the frame is left and the callee returns straight to that caller
+// false, with nothing printed or scheduled, if the call cannot be made this way
+bool generateTailCall(SymbolInfo* call) {
+    auto children = call->getChildren();
+    string callee = children[0]->getName();
+    vector<SymbolInfo*> arguments;
+    if (matchRule(call, "factor : ID LPAREN argument_list RPAREN")) arguments = argumentExpressions(children[2]);
+    // main exits through INT 21H, it has no caller to return to
+    if (functionName == "main" || passesLocalArray(arguments)) return false;
+
+    bool self = callee == functionName && functionEntryLabel != -1 && arguments.size() == functionParameters.size();
+    int inRegisters = isFastcall(callee) ? min(arguments.size(), fastcallRegisters.size()) : 0;
+    if (!self && (int)arguments.size() - inRegisters > functionPushedArguments) return false;
+
+    printCode("; tail call: line-" + lineName(call->getStartLine()) + "\n");
+    // every argument is evaluated before a parameter is overwritten, the last one is still in AX
+    for (int i = 0; i < (int)arguments.size(); i++) {
+        generateLater(arguments[i]);
+        if (i + 1 < (int)arguments.size()) printLater(printPushValue);
+    }
+    printLater([=]() {
+        for (int i = arguments.size() - 1; i >= 0; i--) {
+            if (i + 1 < (int)arguments.size()) printPopValue();
+            if (self) {
+                printStore(functionParameters[i]);
+            } else if (i < inRegisters) {
+                printCode("\tMOV " + fastcallRegisters[i] + ", AX\n");
+            } else {
+                int offset = 4 + intSize() * (i - inRegisters);
+                printCode("\tMOV [BP+" + to_string(offset) + "], AX\n");
+                if (wideValue()) printCode("\tMOV [BP+" + to_string(offset + 2) + "], DX\n");
+            }
+        }
+
+        if (self) {
+            // the locals are declared again from the entry
+            if (functionEntryOffset > 0) {
+                printCode("\tLEA SP, [BP-" + to_string(functionEntryOffset) + "]\n");
+            } else {
+                printCode("\tMOV SP, BP\n");
+            }
+            printJump("JMP", functionEntryLabel);
+        } else {
+            printCode("\tMOV SP, BP\n\tPOP BP\n\tJMP " + callee + "\n");
+        }
+    });
+    return true;
+}
+// func_definition, parameterList is nullptr for a function without parameters
+void generateFunction(SymbolInfo* id, SymbolInfo* parameterList, SymbolInfo* body) {
+    // prev scope offset
+    int tempFunctionStackOffset = functionStackOffset;
+    functionStackOffset = 0;
+    body->exitLabel = newLabel();
+    string name = id->getName();
+
+    vector<SymbolInfo*> parameters;
+    if (parameterList != nullptr) {
+        generateCode(parameterList);
+        parameters = parameterIds(parameterList);
+    }
+
+    bool fastcall = isFastcall(name);
+    bool leaf = !containsRule(body, callRules);
+    bool frame = true;
+    if (fastcall) {
+        // the pushed parameters start at [BP+4], after the ones in registers
+        for (int i = 0; i < (int)parameters.size(); i++) {
+            if (i < (int)fastcallRegisters.size()) {
+                parameters[i]->registerName = fastcallRegisters[i];
+            } else {
+                parameters[i]->stackBuffer = -4 - 2 * (i - (int)fastcallRegisters.size());
+            }
+        }
+        // a leaf without locals and pushed parameters never touches BP
+        frame = !leaf || parameters.size() > fastcallRegisters.size() || containsRule(body, {"statement : var_declaration"});
+    }
+
+    functionName = name;
+    functionParameters = parameters;
+    valueRanges.clear();
+    functionPushedArguments = parameters.size() - (fastcall ? min(parameters.size(), fastcallRegisters.size()) : 0);
+    functionEntryLabel = hasSelfTailCall(body, name) ? newLabel() : -1;
+
+    printCode("\n" + name + " PROC\n");
+
+    // if main function
+    if (name == "main") {
+        printCode("\tMOV AX, @DATA\n\tMOV DS, AX\n");
+        // ES for the string copy of print_output
+        if (outputUsed) printCode("\tMOV ES, AX\n");
+    }
+    if (frame) printCode("\tPUSH BP\n\tMOV BP, SP\n");
+
+    if (fastcall && !leaf) {
+        // the calls in the body overwrite the registers, the parameters are kept as locals
+        for (auto parameter : parameters) {
+            if (parameter->registerName == "") continue;
+            printCode("\tPUSH " + parameter->registerName + "\n");
+            functionStackOffset += 2;
+            parameter->stackBuffer = functionStackOffset;
+            parameter->registerName = "";
+        }
+    }
+    functionEntryOffset = functionStackOffset;
+    if (functionEntryLabel != -1) printLabel(functionEntryLabel);
+
+    generateCode(body);
+    printLabel(body->exitLabel);
+    if (!frame) {
+        printCode("\tRET\n");
+    } else {
+        printCode("\tADD SP, " + to_string(functionStackOffset) + "\n");
+        if (name == "main") {
+            if (outputUsed) printCode("\tCALL flush_output\n");
+            printCode("\tPOP BP\n\tMOV AX, 4C00H\n\tINT 21H\n");
+        } else {
+            printCode("\tMOV SP, BP\n\tPOP BP\n\tRET\n");
+        }
+    }
+
+    printCode(name + " ENDP\n");
+    functionStackOffset = tempFunctionStackOffset;
+}
+
+// the arguments of a call to a fastcall function, the first ones are left in fastcallRegisters
+// and argumentList->stackBuffer counts the pushed ones, popped after the call
+void generateFastcallArguments(SymbolInfo* argumentList) {
+    vector<SymbolInfo*> arguments = argumentExpressions(argumentList);
+
+    int inRegisters = min(arguments.size(), fastcallRegisters.size());
+    bool nestedCall = false;
+    for (int i = 0; i < inRegisters; i++) nestedCall = nestedCall || containsRule(arguments[i], callRules);
+
+    // pushed from the last argument to the first
+    for (int i = arguments.size() - 1; i >= (nestedCall ? 0 : inRegisters); i--) {
+        generateLater(arguments[i]);
+        printLater([]() { printCode("\tMOV BX, AX\n\tPUSH BX\n"); });
+    }
+    if (nestedCall) {
+        // a call in an argument would overwrite the registers, they are loaded after all are evaluated
+        printLater([=]() {
+            for (int i = 0; i < inRegisters; i++) printCode("\tPOP " + fastcallRegisters[i] + "\n");
+        });
+    } else {
+        for (int i = inRegisters - 1; i >= 0; i--) {
+            generateLater(arguments[i]);
+            printLater([=]() { printCode("\tMOV " + fastcallRegisters[i] + ", AX\n"); });
+        }
+    }
+    argumentList->stackBuffer = arguments.size() - inRegisters;
+}
+
+// the rule of one node, run by generateCode: what comes before the first child is printed here,
+// the children and the code between and after them are scheduled
+void generateRule(SymbolInfo* head) {
     auto children = head->getChildren();
 
+    // an operation whose values fit in 16 bits is computed in AX and sign extended into DX, one in
+    // such an operation that needs 32 bit operands is computed in DX:AX and its low word used
+    bool narrowed = false;
+    bool widened = false;
+    if (int32Mode() && isOperation(head)) {
+        ValueRange range = valueRange(head);
+        narrowed = !narrowValues && range.narrow;
+        widened = narrowValues && range.small() && !range.narrow;
+        if (narrowed) narrowValues = true;
+        if (widened) narrowValues = false;
+    }
+
     // start : program
     if (matchRule(head, "start : program")) {
-        printCode(".MODEL SMALL\n.STACK 1000H\n.DATA\n\tCR EQU 0DH\n\tLF EQU 0AH\n\tNUMBER DB \"00000$\"\n");
+        PhaseTimer timer(PHASE_CODEGEN);
+        findReachable(children[0]);
+        printCode(".MODEL SMALL\n.STACK 1000H\n.DATA\n");
+        // ends on an even address, after the bytes of the runtime
+        if (outputUsed) printCode(runtimeData(int32Mode()));
+        string define = int32Mode() ? " DD " : " DW ";
         for (auto globalVar : globalVarInfo->getDeclarations()) {
             if (globalVar->isArray()) {
-                // TODO: handle array as global variable (?)
-                printCode("\t" + globalVar->getName() + " DW 0\n");
+                printCode("\t" + globalVar->getName() + define + to_string(globalVar->getSize()) + " DUP(0)\n");
             } else {
-                printCode("\t" + globalVar->getName() + " DW 0\n");
+                printCode("\t" + globalVar->getName() + define + "0\n");
             }
         }
-        printCode("\tTEN DW 10\n");
         printCode(".CODE\n");
+        // the units are generated before the timer stops
         generateCode(children[0]);
 
-        // new_line PROC
-        printCode(newLineProc);
+        if (outputUsed) {
+            // new_line PROC
+            printCode(newLineProc);
+
+            // print_output PROC
+            printCode(int32Mode() ? printOutputWideProc : printOutputProc);
 
-        // print_output PROC
-        printCode(printOutputProc);
+            // flush_output PROC
+            printCode(flushOutputProc);
+        }
+        if (int32Mode() && divisionUsed) printCode(div32Proc);
         printCode("END main\n");
     }
 
     // program : program unit
     if (matchRule(head, "program : program unit")) {
-        generateCode(children[0]);
-        generateCode(children[1]);
+        generateProgram(head);
     }
 
     // program : unit
     if (matchRule(head, "program : unit")) {
-        generateCode(children[0]);
+        generateProgram(head);
     }
 
     // unit : var_declaration
     if (matchRule(head, "unit : var_declaration")) {
-        generateCode(children[0]);
+        generateLater(children[0]);
     }
 
     // unit : func_declaration
     if (matchRule(head, "unit : func_declaration")) {
-        generateCode(children[0]);
+        generateLater(children[0]);
     }
 
     // unit : func_definition
     if (matchRule(head, "unit : func_definition")) {
-        generateCode(children[0]);
+        generateLater(children[0]);
     }
 
     // func_declaration : type_specifier ID LPAREN parameter_list RPAREN SEMICOLON
@@ -210,71 +1387,33 @@ void generateCode(SymbolInfo* head) {
 
     // func_definition : type_specifier ID LPAREN parameter_list RPAREN compound_statement
     if (matchRule(head, "func_definition : type_specifier ID LPAREN parameter_list RPAREN compound_statement")) {
-        // prev scope offset
-        int tempStackBufferOffset = stackBufferOffset;
-        stackBufferOffset = 0;
-        children[5]->exitLabel = newLabel();
-
-        printCode("\n" + children[1]->getName() + " PROC\n");
-
-        // if main function
-        if (children[1]->getName() == "main") {
-            printCode("\tMOV AX, @DATA\n\tMOV DS, AX\n");
-        }
-        printCode("\tPUSH BP\n\tMOV BP, SP\n");
-
-        generateCode(children[3]);
-        generateCode(children[5]);
-        printLabel(children[5]->exitLabel);
-        printCode("\tADD SP, " + to_string(stackBufferOffset) + "\n");
-        if (children[1]->getName() == "main") {
-            printCode("\tPOP BP\n\tMOV AX, 4CH\n\tINT 21H\n");
-        } else {
-            printCode("\tMOV SP, BP\n\tPOP BP\n\tRET\n");
-        }
-
-        printCode(children[1]->getName() + " ENDP\n");
-        stackBufferOffset = tempStackBufferOffset;
+        generateFunction(children[1], children[3], children[5]);
     }
 
     // func_definition : type_specifier ID LPAREN RPAREN compound_statement
     if (matchRule(head, "func_definition : type_specifier ID LPAREN RPAREN compound_statement")) {
-        int tempStackBufferOffset = stackBufferOffset;
-        stackBufferOffset = 0;
-        children[4]->exitLabel = newLabel();
-
-        printCode("\n" + children[1]->getName() + " PROC\n");
-
-        // if main function
-        if (children[1]->getName() == "main") {
-            printCode("\tMOV AX, @DATA\n\tMOV DS, AX\n");
-        }
-        printCode("\tPUSH BP\n\tMOV BP, SP\n");
-
-        generateCode(children[4]);
-        printLabel(children[4]->exitLabel);
-        printCode("\tADD SP, " + to_string(stackBufferOffset) + "\n");
-        if (children[1]->getName() == "main") {
-            printCode("\tPOP BP\n\tMOV AX, 4CH\n\tINT 21H\n");
-        } else {
-            printCode("\tMOV SP, BP\n\tPOP BP\n\tRET\n");
-        }
-
-        printCode(children[1]->getName() + " ENDP\n");
-        stackBufferOffset = tempStackBufferOffset;
+        generateFunction(children[1], nullptr, children[4]);
     }
 
     // parameter_list : parameter_list COMMA type_specifier ID
-    if (matchRule(head, "parameter_list : parameter_list COMMA type_specifier ID")) {
-        // TODO: handle array as parameter (?)
-        generateCode(children[0]);
-        if (children[3]->isArray()) {
-            head->stackBuffer = children[0]->stackBuffer - 2 * children[3]->getSize();
-            children[3]->stackBuffer = children[0]->stackBuffer - 2;
-        } else {
-            children[3]->stackBuffer = children[0]->stackBuffer - 2;
-            head->stackBuffer = children[3]->stackBuffer;
+    // parameter_list : parameter_list COMMA type_specifier ID LSQUARE RSQUARE
+    if (matchRule(head, "parameter_list : parameter_list COMMA type_specifier ID") || matchRule(head, "parameter_list : parameter_list COMMA type_specifier ID LSQUARE RSQUARE")) {
+        // the chain is walked down to the first parameter and offsets are assigned from there
+        vector<SymbolInfo*> chain;
+        SymbolInfo* node = head;
+        for (; matchRule(node, "parameter_list : parameter_list COMMA type_specifier ID") || matchRule(node, "parameter_list : parameter_list COMMA type_specifier ID LSQUARE RSQUARE"); node = node->getChildren()[0]) {
+            chain.push_back(node);
         }
+        generateLater(node);
+
+        // an array parameter is the address of the array, one slot like any other parameter
+        printLater([=]() {
+            for (auto it = chain.rbegin(); it != chain.rend(); it++) {
+                auto link = (*it)->getChildren();
+                link[3]->stackBuffer = link[0]->stackBuffer - intSize();
+                (*it)->stackBuffer = link[3]->stackBuffer;
+            }
+        });
     }
 
     // parameter_list : parameter_list COMMA type_specifier
@@ -282,8 +1421,8 @@ void generateCode(SymbolInfo* head) {
     }
 
     // parameter_list : type_specifier ID
-    if (matchRule(head, "parameter_list : type_specifier ID")) {
-        // TODO: handle array (?)
+    // parameter_list : type_specifier ID LSQUARE RSQUARE
+    if (matchRule(head, "parameter_list : type_specifier ID") || matchRule(head, "parameter_list : type_specifier ID LSQUARE RSQUARE")) {
         // 2 for return pointer, 2 extra
         children[1]->stackBuffer = -4;
         head->stackBuffer = children[1]->stackBuffer;
@@ -296,7 +1435,7 @@ void generateCode(SymbolInfo* head) {
     // compound_statement : LCURL statements RCURL
     if (matchRule(head, "compound_statement : LCURL statements RCURL")) {
         children[1]->exitLabel = head->exitLabel;
-        generateCode(children[1]);
+        generateLater(children[1]);
     }
 
     // compound_statement : LCURL RCURL
@@ -306,23 +1445,12 @@ void generateCode(SymbolInfo* head) {
     // var_declaration : type_specifier declaration_list SEMICOLON
     if (matchRule(head, "var_declaration : type_specifier declaration_list SEMICOLON")) {
         for (auto var : children[1]->getDeclarations()) {
-            // var is not a global variable
+            // var is not a global variable, globals are laid out in .DATA
             if (!isGlobalVar(var)) {
-                if (var->isArray()) {
-                    int size = 2 * var->getSize();
-                    printCode("\tSUB SP, " + to_string(size) + "\n");
-                    var->stackBuffer = stackBufferOffset + 2;
-                    stackBufferOffset += size;
-                } else {
-                    printCode("\tSUB SP, 2\n");
-                    stackBufferOffset += 2;
-                    var->stackBuffer = stackBufferOffset;
-                }
-            } else {
-                if (var->isArray()) {
-                    var->stackBuffer = globalArrayOffset;
-                    globalArrayOffset += (2 * var->getSize());
-                }
+                int size = var->isArray() ? intSize() * var->getSize() : intSize();
+                printCode("\tSUB SP, " + to_string(size) + "\n");
+                functionStackOffset += size;
+                var->stackBuffer = functionStackOffset;
             }
         }
     }
@@ -355,36 +1483,45 @@ void generateCode(SymbolInfo* head) {
     if (matchRule(head, "declaration_list : ID LSQUARE CONST_INT RSQUARE")) {
     }
 
+
     // statements : statement
     if (matchRule(head, "statements : statement")) {
         children[0]->exitLabel = head->exitLabel;
-        generateCode(children[0]);
+        generateLater(children[0]);
     }
 
     // statements : statements statement
     if (matchRule(head, "statements : statements statement")) {
-        children[0]->exitLabel = head->exitLabel;
-        children[1]->exitLabel = head->exitLabel;
-        generateCode(children[0]);
-        generateCode(children[1]);
+        vector<SymbolInfo*> statements;
+        SymbolInfo* node = head;
+        for (; matchRule(node, "statements : statements statement"); node = node->getChildren()[0]) {
+            node->getChildren()[0]->exitLabel = head->exitLabel;
+            statements.push_back(node->getChildren()[1]);
+        }
+        statements.push_back(node->getChildren()[0]);
+
+        for (auto it = statements.rbegin(); it != statements.rend(); it++) {
+            (*it)->exitLabel = head->exitLabel;
+            generateLater(*it);
+        }
     }
 
     // statement : var_declaration
     if (matchRule(head, "statement : var_declaration")) {
-        printCode("; var_declaration: line-" + to_string(head->getEndLine()) + "\n");
-        generateCode(children[0]);
+        printCode("; var_declaration: line-" + lineName(head->getEndLine()) + "\n");
+        generateLater(children[0]);
     }
 
     // statement : expression_statement
     if (matchRule(head, "statement : expression_statement")) {
-        // printCode("; evaluating expression: line-" + to_string(head->getEndLine()) + "\n");
-        generateCode(children[0]);
+        // printCode("; evaluating expression: line-" + lineName(head->getEndLine()) + "\n");
+        generateLater(children[0]);
     }
 
     // statement : compound_statement
     if (matchRule(head, "statement : compound_statement")) {
         children[0]->exitLabel = head->exitLabel;
-        generateCode(children[0]);
+        generateLater(children[0]);
     }
 
     // statement : FOR LPAREN expression_statement expression_statement expression RPAREN statement
@@ -393,17 +1530,27 @@ void generateCode(SymbolInfo* head) {
         int nextLabel = newLabel();
         children[6]->exitLabel = head->exitLabel;
 
-        printCode("; for loop: line-" + to_string(head->getStartLine()) + "\n");
-
-        generateCode(children[2]);
-        printLabel(loopLabel);
-        generateCode(children[3]);
-        printCode("\tCMP AX, 0\n");
-        printJump("JE", nextLabel);
-        generateCode(children[6]);
-        generateCode(children[4]);
-        printJump("JMP", loopLabel);
-        printLabel(nextLabel);
+        // the values of a counter bounded by constants are known in the loop
+        long long lo, hi;
+        SymbolInfo* counter = int32Mode() ? loopCounter(head, lo, hi) : nullptr;
+        if (counter != nullptr) loopCounters[counter] = {lo, hi};
+
+        printCode("; for loop: line-" + lineName(head->getStartLine()) + "\n");
+
+        generateLater(children[2]);
+        printLater([=]() { printLabel(loopLabel); });
+        generateLater(children[3]);
+        printLater([=]() {
+            printTestValue(children[3]);
+            printJump("JE", nextLabel);
+        });
+        generateLater(children[6]);
+        generateLater(children[4]);
+        printLater([=]() {
+            printJump("JMP", loopLabel);
+            printLabel(nextLabel);
+            if (counter != nullptr) loopCounters.erase(counter);
+        });
     }
 
     // statement : IF LPAREN expression RPAREN statement
@@ -412,14 +1559,16 @@ void generateCode(SymbolInfo* head) {
         int nextLabel = newLabel();
         children[4]->exitLabel = head->exitLabel;
 
-        printCode("; if logic evaluation: line-" + to_string(head->getStartLine()) + "\n");
-        generateCode(children[2]);
-        printCode("\tCMP AX, 0\n");
-        printJump("JE", nextLabel);
-        printCode("; if statement: line-" + to_string(head->getStartLine()) + "\n");
-        printLabel(trueLabel);
-        generateCode(children[4]);
-        printLabel(nextLabel);
+        printCode("; if logic evaluation: line-" + lineName(head->getStartLine()) + "\n");
+        generateLater(children[2]);
+        printLater([=]() {
+            printTestValue(children[2]);
+            printJump("JE", nextLabel);
+            printCode("; if statement: line-" + lineName(head->getStartLine()) + "\n");
+            printLabel(trueLabel);
+        });
+        generateLater(children[4]);
+        printLater([=]() { printLabel(nextLabel); });
     }
 
     // statement : IF LPAREN expression RPAREN statement ELSE statement
@@ -430,18 +1579,22 @@ void generateCode(SymbolInfo* head) {
         children[4]->exitLabel = head->exitLabel;
         children[6]->exitLabel = head->exitLabel;
 
-        printCode("; if logic evaluation: line-" + to_string(head->getStartLine()) + "\n");
-        generateCode(children[2]);
-        printCode("\tCMP AX, 0\n");
-        printJump("JE", falseLabel);
-        printCode("; if statement: line-" + to_string(head->getStartLine()) + "\n");
-        printLabel(trueLabel);
-        generateCode(children[4]);
-        printJump("JMP", nextLabel);
-        printCode("; else statement: line-" + to_string(head->getStartLine()) + "\n");
-        printLabel(falseLabel);
-        generateCode(children[6]);
-        printLabel(nextLabel);
+        printCode("; if logic evaluation: line-" + lineName(head->getStartLine()) + "\n");
+        generateLater(children[2]);
+        printLater([=]() {
+            printTestValue(children[2]);
+            printJump("JE", falseLabel);
+            printCode("; if statement: line-" + lineName(head->getStartLine()) + "\n");
+            printLabel(trueLabel);
+        });
+        generateLater(children[4]);
+        printLater([=]() {
+            printJump("JMP", nextLabel);
+            printCode("; else statement: line-" + lineName(head->getStartLine()) + "\n");
+            printLabel(falseLabel);
+        });
+        generateLater(children[6]);
+        printLater([=]() { printLabel(nextLabel); });
     }
 
     // statement : WHILE LPAREN expression RPAREN statement
@@ -450,31 +1603,34 @@ void generateCode(SymbolInfo* head) {
         int nextLabel = newLabel();
         children[4]->exitLabel = head->exitLabel;
 
-        printCode("; while loop: line-" + to_string(head->getStartLine()) + "\n");
+        printCode("; while loop: line-" + lineName(head->getStartLine()) + "\n");
         printLabel(loopLabel);
-        generateCode(children[2]);
-        printCode("\tCMP AX, 0\n");
-        printJump("JE", nextLabel);
-        generateCode(children[4]);
-        printJump("JMP", loopLabel);
-        printLabel(nextLabel);
+        generateLater(children[2]);
+        printLater([=]() {
+            printTestValue(children[2]);
+            printJump("JE", nextLabel);
+        });
+        generateLater(children[4]);
+        printLater([=]() {
+            printJump("JMP", loopLabel);
+            printLabel(nextLabel);
+        });
     }
 
     // statement : PRINTLN LPAREN ID RPAREN SEMICOLON
     if (matchRule(head, "statement : PRINTLN LPAREN ID RPAREN SEMICOLON")) {
-        printCode("; print: line-" + to_string(head->getStartLine()) + "\n");
-        if (isGlobalVar(children[2])) {
-            printCode("\tMOV AX, " + children[2]->getName() + "\n\tCALL print_output\n\tCALL new_line\n");
-        } else {
-            printMovAxBp(children[2]);
-            printCode("\tCALL print_output\n\tCALL new_line\n");
-        }
+        printCode("; print: line-" + lineName(head->getStartLine()) + "\n");
+        printLoad(children[2]);
+        printCode("\tCALL print_output\n\tCALL new_line\n");
     }
 
     // statement : RETURN expression SEMICOLON
     if (matchRule(head, "statement : RETURN expression SEMICOLON")) {
-        generateCode(children[1]);
-        printJump("JMP", head->exitLabel);
+        SymbolInfo* call = tailCall(children[1]);
+        if (call == nullptr || !generateTailCall(call)) {
+            generateLater(children[1]);
+            printLater([=]() { printJump("JMP", head->exitLabel); });
+        }
     }
 
     // expression_statement : SEMICOLON
@@ -483,60 +1639,66 @@ void generateCode(SymbolInfo* head) {
 
     // expression_statement : expression SEMICOLON
     if (matchRule(head, "expression_statement : expression SEMICOLON")) {
-        generateCode(children[0]);
+        generateLater(children[0]);
     }
 
     // variable : ID
     if (matchRule(head, "variable : ID")) {
-        printMovAxBp(children[0]);
+        printLoad(children[0]);
     }
 
     // variable : ID LSQUARE expression RSQUARE
     if (matchRule(head, "variable : ID LSQUARE expression RSQUARE")) {
-        generateCode(children[2]);
-        // BP - (stackBuffer + 2*AX)
-        if (isGlobalVar(children[0])) {
-            printCode("\tMOV BX, AX\n\tSHL BX, 1\n\tADD BX, " + to_string(children[0]->stackBuffer) + "\n\tNEG BX\n\tADD BX, " + children[0]->getName() + "\n");
-        } else {
-            printCode("\tMOV BX, AX\n\tSHL BX, 1\n\tADD BX, " + to_string(children[0]->stackBuffer) + "\n\tNEG BX\n\tADD BX, BP\n");
-        }
+        // only the low word of an index is used
+        bool narrow = narrowValues;
+        narrowValues = narrow || (int32Mode() && narrowIndex(children[2]));
+        generateLater(children[2]);
+
+        printLater([=]() {
+            narrowValues = narrow;
+
+            // global: the offset size*AX, used as [name+BX]
+            // parameter: the address it holds + size*AX
+            // local: the address BP - stackBuffer + size*AX
+            string offset = int32Mode() ? "\tMOV BX, AX\n\tSHL BX, 1\n\tSHL BX, 1\n" : "\tMOV BX, AX\n\tSHL BX, 1\n";
+            if (isGlobalVar(children[0])) {
+                printCode(offset);
+            } else if (children[0]->getSize() == 0) {
+                printCode(offset + "\tADD BX, " + stackOperand(children[0]) + "\n");
+            } else {
+                printCode(offset + "\tADD BX, BP\n\tSUB BX, " + to_string(children[0]->stackBuffer) + "\n");
+            }
+        });
     }
 
     // expression : logic_expression
     if (matchRule(head, "expression : logic_expression")) {
-        generateCode(children[0]);
+        generateLater(children[0]);
     }
 
     // expression : variable ASSIGNOP logic_expression
     if (matchRule(head, "expression : variable ASSIGNOP logic_expression")) {
         SymbolInfo* var = children[0]->getChildren()[0];
 
-        printCode("; assignment: line-" + to_string(children[1]->getStartLine()) + "\n");
-        if (isGlobalVar(var)) {
-            // handle global variables
-            if (var->isArray()) {
-                generateCode(children[0]);
-                generateCode(children[2]);
-                printCode("\tMOV [BX], AX\n");
-            } else {
-                generateCode(children[2]);
-                printCode("\tMOV " + var->getName() + ", AX\n");
-            }
+        printCode("; assignment: line-" + lineName(children[1]->getStartLine()) + "\n");
+        if (var->isArray()) {
+            // the right side can index an array or call a function, BX is kept on the stack
+            generateLater(children[0]);
+            printLater([]() { printCode("\tPUSH BX\n"); });
+            generateLater(children[2]);
+            printLater([=]() {
+                printCode("\tPOP BX\n");
+                printStoreElement(var);
+            });
         } else {
-            if (var->isArray()) {
-                generateCode(children[0]);
-                generateCode(children[2]);
-                printCode("\tMOV [BX], AX\n");
-            } else {
-                generateCode(children[2]);
-                printMovBpAx(var);
-            }
+            generateLater(children[2]);
+            printLater([=]() { printStore(var); });
         }
     }
 
     // logic_expression : rel_expression
     if (matchRule(head, "logic_expression : rel_expression")) {
-        generateCode(children[0]);
+        generateLater(children[0]);
     }
 
     // logic_expression : rel_expression LOGICOP rel_expression
@@ -546,36 +1708,41 @@ void generateCode(SymbolInfo* head) {
         int falseLabel = newLabel();
         int nextLabel = newLabel();
 
-        generateCode(children[0]);
-        printCode("\tCMP AX, 0\n");
+        generateLater(children[0]);
+        printLater([=]() {
+            printTestValue(children[0]);
 
-        if (children[1]->getName() == "||") {
-            printJump("JNE", trueLabel);
-            // printJump("JMP", nextBoolLabel);
-        } else {
-            printJump("JE", falseLabel);
-        }
+            if (children[1]->getName() == "||") {
+                printJump("JNE", trueLabel);
+                // printJump("JMP", nextBoolLabel);
+            } else {
+                printJump("JE", falseLabel);
+            }
 
-        printLabel(nextBoolLabel);
-        generateCode(children[2]);
-        printCode("\tCMP AX, 0\n");
+            printLabel(nextBoolLabel);
+        });
+        generateLater(children[2]);
+        printLater([=]() {
+            printTestValue(children[2]);
 
-        printJump("JNE", trueLabel);
-        printJump("JMP", falseLabel);
+            printJump("JNE", trueLabel);
+            printJump("JMP", falseLabel);
 
-        printLabel(trueLabel);
-        printCode("\tMOV AX, 1\n");
-        printJump("JMP", nextLabel);
+            printLabel(trueLabel);
+            printCode("\tMOV AX, 1\n");
+            printJump("JMP", nextLabel);
 
-        printLabel(falseLabel);
-        printCode("\tMOV AX, 0\n");
+            printLabel(falseLabel);
+            printCode("\tMOV AX, 0\n");
 
-        printLabel(nextLabel);
+            printLabel(nextLabel);
+            if (wideValue()) printCode("\tXOR DX, DX\n");
+        });
     }
 
     // rel_expression : simple_expression
     if (matchRule(head, "rel_expression : simple_expression")) {
-        generateCode(children[0]);
+        generateLater(children[0]);
     }
 
     // rel_expression : simple_expression RELOP simple_expression
@@ -584,89 +1751,156 @@ void generateCode(SymbolInfo* head) {
         int falseLabel = newLabel();
         int nextLabel = newLabel();
 
-        generateCode(children[0]);
-        printCode("\tPUSH AX\n");
-        generateCode(children[2]);
-        printCode("\tMOV DX, AX\n\tPOP AX\n");
-        printCode("\tCMP AX, DX\n");
-
-        string jump = "";
-        if (children[1]->getName() == ">=") {
-            // ax >= dx
-            jump = "JGE";
-        } else if (children[1]->getName() == "<=") {
-            // ax <= dx
-            jump = "JLE";
-        } else if (children[1]->getName() == "==") {
-            // ax == dx
-            jump = "JE";
-        } else if (children[1]->getName() == "!=") {
-            // ax != dx
-            jump = "JNE";
-        } else if (children[1]->getName() == "<") {
-            // ax < dx
-            jump = "JL";
-        } else {
-            // ax > dx
-            jump = "JG";
-        }
-
-        printJump(jump, trueLabel);
-        printJump("JMP", falseLabel);
+        string op = children[1]->getName();
+        generateLater(children[0]);
+        printLater(printPushValue);
+        generateLater(children[2]);
+        printLater([=]() {
+            if (wideValue()) {
+                // DX:AX against CX:BX: the high words decide, signed, unless they are equal,
+                // then the low words decide, unsigned
+                printWideOperands();
+                if (op == "==" || op == "!=") {
+                    printCode("\tCMP AX, BX\n");
+                    printJump("JNE", op == "==" ? falseLabel : trueLabel);
+                    printCode("\tCMP DX, CX\n");
+                    printJump(op == "==" ? "JE" : "JNE", trueLabel);
+                } else {
+                    bool less = op == "<" || op == "<=";
+                    printCode("\tCMP DX, CX\n");
+                    printJump(less ? "JL" : "JG", trueLabel);
+                    printJump(less ? "JG" : "JL", falseLabel);
+                    printCode("\tCMP AX, BX\n");
+                    printJump(op == "<" ? "JB" : op == "<=" ? "JBE" : op == ">" ? "JA" : "JAE", trueLabel);
+                }
+            } else {
+                printCode("\tMOV DX, AX\n\tPOP AX\n");
+                printCode("\tCMP AX, DX\n");
+
+                string jump = "";
+                if (op == ">=") {
+                    // ax >= dx
+                    jump = "JGE";
+                } else if (op == "<=") {
+                    // ax <= dx
+                    jump = "JLE";
+                } else if (op == "==") {
+                    // ax == dx
+                    jump = "JE";
+                } else if (op == "!=") {
+                    // ax != dx
+                    jump = "JNE";
+                } else if (op == "<") {
+                    // ax < dx
+                    jump = "JL";
+                } else {
+                    // ax > dx
+                    jump = "JG";
+                }
+                printJump(jump, trueLabel);
+            }
+            printJump("JMP", falseLabel);
 
-        printLabel(trueLabel);
-        printCode("\tMOV AX, 1\n");
-        printJump("JMP", nextLabel);
-        printLabel(falseLabel);
-        printCode(("\tMOV AX, 0\n"));
-        printLabel(nextLabel);
+            printLabel(trueLabel);
+            printCode("\tMOV AX, 1\n");
+            printJump("JMP", nextLabel);
+            printLabel(falseLabel);
+            printCode(("\tMOV AX, 0\n"));
+            printLabel(nextLabel);
+            if (wideValue()) printCode("\tXOR DX, DX\n");
+        });
     }
 
     // simple_expression : term
     if (matchRule(head, "simple_expression : term")) {
-        generateCode(children[0]);
+        generateLater(children[0]);
     }
 
     // simple_expression : simple_expression ADDOP term
     if (matchRule(head, "simple_expression : simple_expression ADDOP term")) {
-        generateCode(children[0]);
-        printCode("\tPUSH AX\n");
-        generateCode(children[2]);
-        printCode("\tMOV DX, AX\n\tPOP AX\n");
+        // a + b + c is a chain down to the first term, evaluated from there
+        vector<SymbolInfo*> chain;
+        SymbolInfo* node = head;
+        for (; matchRule(node, "simple_expression : simple_expression ADDOP term"); node = node->getChildren()[0]) {
+            chain.push_back(node);
+        }
+        generateLater(node);
+
+        for (auto it = chain.rbegin(); it != chain.rend(); it++) {
+            auto link = (*it)->getChildren();
+            printLater(printPushValue);
+            generateLater(link[2]);
+            printLater([=]() {
+                if (wideValue()) {
+                    printWideOperands();
+                    if (link[1]->getName() == "+") {
+                        printCode("\tADD AX, BX\n\tADC DX, CX\n");
+                    } else {
+                        printCode("\tSUB AX, BX\n\tSBB DX, CX\n");
+                    }
+                    return;
+                }
+                printCode("\tMOV DX, AX\n\tPOP AX\n");
 
-        if (children[1]->getName() == "+") {
-            printCode("\tADD AX, DX\n");
-        } else {
-            printCode("\tSUB AX, DX\n");
+                if (link[1]->getName() == "+") {
+                    printCode("\tADD AX, DX\n");
+                } else {
+                    printCode("\tSUB AX, DX\n");
+                }
+            });
         }
     }
 
     // term : unary_expression
     if (matchRule(head, "term : unary_expression")) {
-        generateCode(children[0]);
+        generateLater(children[0]);
     }
 
     // term : term MULOP unary_expression
     if (matchRule(head, "term : term MULOP unary_expression")) {
-        generateCode(children[0]);
-        printCode("\tPUSH AX\n");
-        generateCode(children[2]);
-        printCode("\tMOV CX, AX\n\tPOP AX\n");
-
-        if (children[1]->getName() == "*") {
-            printCode("\tCWD\n\tMUL CX\n");
-        } else if (children[1]->getName() == "%") {
-            printCode("\tCWD\n\tDIV CX\n\tMOV AX, DX\n");
-        } else {
-            printCode("\tCWD\n\tDIV CX\n");
+        vector<SymbolInfo*> chain;
+        SymbolInfo* node = head;
+        for (; matchRule(node, "term : term MULOP unary_expression"); node = node->getChildren()[0]) {
+            chain.push_back(node);
+        }
+        generateLater(node);
+
+        for (auto it = chain.rbegin(); it != chain.rend(); it++) {
+            auto link = (*it)->getChildren();
+            printLater(printPushValue);
+            generateLater(link[2]);
+            printLater([=]() {
+                if (wideValue()) {
+                    printWideOperands();
+                    if (link[1]->getName() == "*") {
+                        // the low 32 bits of the product: lo*lo + (hi*lo + lo*hi) << 16
+                        printCode("\tPUSH SI\n\tMOV SI, AX\n\tMOV AX, DX\n\tMUL BX\n\tXCHG AX, CX\n\tMUL SI\n\tADD CX, AX\n");
+                        printCode("\tMOV AX, SI\n\tMUL BX\n\tADD DX, CX\n\tPOP SI\n");
+                    } else if (link[1]->getName() == "%") {
+                        printCode("\tCALL div32\n\tMOV AX, BX\n\tMOV DX, CX\n");
+                    } else {
+                        printCode("\tCALL div32\n");
+                    }
+                    return;
+                }
+                printCode("\tMOV CX, AX\n\tPOP AX\n");
+
+                if (link[1]->getName() == "*") {
+                    printCode("\tCWD\n\tMUL CX\n");
+                } else if (link[1]->getName() == "%") {
+                    printCode("\tCWD\n\tDIV CX\n\tMOV AX, DX\n");
+                } else {
+                    printCode("\tCWD\n\tDIV CX\n");
+                }
+            });
         }
     }
 
     // unary_expression : ADDOP unary_expression
     if (matchRule(head, "unary_expression : ADDOP unary_expression")) {
-        generateCode(children[1]);
+        generateLater(children[1]);
         if (children[0]->getName() == "-") {
-            printCode("\tNEG AX\n");
+            printLater([]() { printCode(wideValue() ? "\tNEG DX\n\tNEG AX\n\tSBB DX, 0\n" : "\tNEG AX\n"); });
         }
     }
 
@@ -675,49 +1909,57 @@ void generateCode(SymbolInfo* head) {
         int trueLabel = newLabel();
         int nextLabel = newLabel();
 
-        generateCode(children[1]);
-        printCode("\tCMP AX, 0\n");
-        printJump("JE", trueLabel);
-        printCode("\tMOV AX, 0\n");
-        printJump("JMP", nextLabel);
-        printLabel(trueLabel);
-        printCode("\tMOV AX, 1\n");
-        printLabel(nextLabel);
+        generateLater(children[1]);
+        printLater([=]() {
+            printTestValue(children[1]);
+            printJump("JE", trueLabel);
+            printCode("\tMOV AX, 0\n");
+            printJump("JMP", nextLabel);
+            printLabel(trueLabel);
+            printCode("\tMOV AX, 1\n");
+            printLabel(nextLabel);
+            if (wideValue()) printCode("\tXOR DX, DX\n");
+        });
     }
 
     // unary_expression : factor
     if (matchRule(head, "unary_expression : factor")) {
-        generateCode(children[0]);
+        generateLater(children[0]);
     }
 
     // factor : variable
     if (matchRule(head, "factor : variable")) {
         auto var = children[0]->getChildren()[0];
-        if (isGlobalVar(var)) {
-            if (var->isArray()) {
-                generateCode(children[0]);
-                printCode("\tMOV AX, [BX]\n");
-            } else {
-                printCode("\tMOV AX, " + var->getName() + "\n");
-            }
+        if (var->isArray() && matchRule(children[0], "variable : ID")) {
+            // a whole array, passed as an argument
+            printArrayAddress(var);
+        } else if (var->isArray()) {
+            generateLater(children[0]);
+            printLater([=]() { printLoadElement(var); });
         } else {
-            if (var->isArray()) {
-                generateCode(children[0]);
-                printCode("\tMOV AX, [BX]\n");
-            } else {
-                printMovAxBp(var);
-            }
+            printLoad(var);
         }
     }
 
     // factor : ID LPAREN argument_list RPAREN
     if (matchRule(head, "factor : ID LPAREN argument_list RPAREN")) {
-        generateCode(children[2]);
-        printCode("\tCALL " + children[0]->getName() + "\n");
-
-        for (int i = 0; i < children[2]->stackBuffer; i++) {
-            printCode("\tPOP BX\n");
+        if (isFastcall(children[0]->getName())) {
+            generateFastcallArguments(children[2]);
+        } else {
+            generateLater(children[2]);
         }
+        printLater([=]() {
+            printCode("\tCALL " + children[0]->getName() + "\n");
+
+            if (int32Mode()) {
+                // DX holds the high word of the result
+                printCode("\tADD SP, " + to_string(4 * children[2]->stackBuffer) + "\n");
+            } else {
+                for (int i = 0; i < children[2]->stackBuffer; i++) {
+                    printCode("\tPOP BX\n");
+                }
+            }
+        });
     }
 
     // factor : ID LPAREN RPAREN
@@ -727,12 +1969,18 @@ void generateCode(SymbolInfo* head) {
 
     // factor : LPAREN expression RPAREN
     if (matchRule(head, "factor : LPAREN expression RPAREN")) {
-        generateCode(children[1]);
+        generateLater(children[1]);
     }
 
     // factor : CONST_INT
     if (matchRule(head, "factor : CONST_INT")) {
-        printCode("\tMOV AX, " + children[0]->getName() + "\n");
+        if (int32Mode()) {
+            uint32_t value = literalBits(children[0]->getName());
+            printCode("\tMOV AX, " + to_string(value & 0xFFFF) + "\n");
+            if (wideValue()) printCode((value >> 16) == 0 ? "\tXOR DX, DX\n" : "\tMOV DX, " + to_string((value >> 16) & 0xFFFF) + "\n");
+        } else {
+            printCode("\tMOV AX, " + children[0]->getName() + "\n");
+        }
     }
 
     // factor : CONST_FLOAT
@@ -741,19 +1989,21 @@ void generateCode(SymbolInfo* head) {
 
     // factor : variable INCOP
     if (matchRule(head, "factor : variable INCOP")) {
-        // FIXME: array
+        // the value before the increment is left in AX
         SymbolInfo* var = children[0]->getChildren()[0];
-        if (isGlobalVar(var)) {
+        if (wideValue()) {
+            printWideStep(children[0], "ADD", "ADC");
+        } else if (isGlobalVar(var)) {
             if (var->isArray()) {
-                generateCode(children[0]);
-                printCode("\tINC [BX]\n");
+                generateLater(children[0]);
+                printLater([=]() { printCode("\tMOV AX, [" + var->getName() + "+BX]\n\tINC [" + var->getName() + "+BX]\n"); });
             } else {
-                printCode("\tINC " + var->getName() + "\n");
+                printCode("\tMOV AX, " + var->getName() + "\n\tINC " + var->getName() + "\n");
             }
         } else {
             if (var->isArray()) {
-                generateCode(children[0]);
-                printCode("\tINC [BX]\n");
+                generateLater(children[0]);
+                printLater([]() { printCode("\tMOV AX, [BX]\n\tINC [BX]\n"); });
             } else {
                 printMovAxBp(var);
                 printCode("\tINC AX\n");
@@ -765,19 +2015,21 @@ void generateCode(SymbolInfo* head) {
 
     // factor : variable DECOP
     if (matchRule(head, "factor : variable DECOP")) {
-        // FIXME: array
+        // the value before the decrement is left in AX
         SymbolInfo* var = children[0]->getChildren()[0];
-        if (isGlobalVar(var)) {
+        if (wideValue()) {
+            printWideStep(children[0], "SUB", "SBB");
+        } else if (isGlobalVar(var)) {
             if (var->isArray()) {
-                generateCode(children[0]);
-                printCode("\tDEC [BX]\n");
+                generateLater(children[0]);
+                printLater([=]() { printCode("\tMOV AX, [" + var->getName() + "+BX]\n\tDEC [" + var->getName() + "+BX]\n"); });
             } else {
-                printCode("\tDEC " + var->getName() + "\n");
+                printCode("\tMOV AX, " + var->getName() + "\n\tDEC " + var->getName() + "\n");
             }
         } else {
             if (var->isArray()) {
-                generateCode(children[0]);
-                printCode("\tDEC [BX]\n");
+                generateLater(children[0]);
+                printLater([]() { printCode("\tMOV AX, [BX]\n\tDEC [BX]\n"); });
             } else {
                 printMovAxBp(var);
                 printCode("\tDEC AX\n");
@@ -789,24 +2041,67 @@ void generateCode(SymbolInfo* head) {
 
     // argument_list : arguments
     if (matchRule(head, "argument_list : arguments")) {
-        generateCode(children[0]);
-        head->stackBuffer = children[0]->stackBuffer;
+        generateLater(children[0]);
+        printLater([=]() { head->stackBuffer = children[0]->stackBuffer; });
 
         // keeping track of argument size in stackBuffer to pop after function call
     }
 
     // arguments : arguments COMMA logic_expression
     if (matchRule(head, "arguments : arguments COMMA logic_expression")) {
-        generateCode(children[2]);
-        printCode("\tMOV BX, AX\n\tPUSH BX\n");
-        generateCode(children[0]);
-        head->stackBuffer = children[0]->stackBuffer + 1;
+        // pushed from the last argument to the first
+        vector<SymbolInfo*> chain;
+        SymbolInfo* node = head;
+        for (; matchRule(node, "arguments : arguments COMMA logic_expression"); node = node->getChildren()[0]) {
+            chain.push_back(node);
+            generateLater(node->getChildren()[2]);
+            printLater(printPushArgument);
+        }
+        generateLater(node);
+
+        printLater([=]() {
+            for (auto it = chain.rbegin(); it != chain.rend(); it++) {
+                (*it)->stackBuffer = (*it)->getChildren()[0]->stackBuffer + 1;
+            }
+        });
     }
 
     // arguments : logic_expression
     if (matchRule(head, "arguments : logic_expression")) {
-        generateCode(children[0]);
-        printCode("\tMOV BX, AX\n\tPUSH BX\n");
+        generateLater(children[0]);
+        printLater(printPushArgument);
         head->stackBuffer = 1;
     }
+
+    if (narrowed) {
+        printLater([]() {
+            narrowValues = false;
+            printCode("\tCWD\n");
+        });
+    }
+    if (widened) printLater([]() { narrowValues = true; });
+}
+
+// runs the steps of head's subtree; the rules schedule their children instead of calling this,
+// so only the bounded calls of generateProgram and generateFunction nest
+void generateCode(SymbolInfo* head) {
+    vector<CodegenStep> callerSteps;
+    swap(callerSteps, scheduledSteps);
+
+    size_t base = codegenSteps.size();
+    codegenSteps.push_back({head, nullptr});
+    while (codegenSteps.size() > base) {
+        CodegenStep step = move(codegenSteps.back());
+        codegenSteps.pop_back();
+        if (step.action) {
+            step.action();
+        } else {
+            generateRule(step.node);
+        }
+        // pushed last to first, the first one scheduled runs next
+        codegenSteps.insert(codegenSteps.end(), make_move_iterator(scheduledSteps.rbegin()), make_move_iterator(scheduledSteps.rend()));
+        scheduledSteps.clear();
+    }
+
+    swap(callerSteps, scheduledSteps);
 }
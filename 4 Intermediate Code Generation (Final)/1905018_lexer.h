@@ -0,0 +1,250 @@
+#ifndef LEXER
+#define LEXER
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "classes/compilerStats.h"
+#include "classes/symbolInfo.h"
+#include "classes/symbolTable.h"
+
+// state and helpers shared by the flex lexer (1905018.l) and the hand written scanner (1905018_scanner.cpp)
+// only one of them is linked into the compiler
+
+using namespace std;
+
+extern YYSTYPE yylval;
+extern SymbolTable* symbolTable;
+extern int yylineno;
+void yyerror(string s);
+int lineCount = 1;
+int errorCount = 0;
+
+int commentBeginLine;
+string commentString;
+
+extern FILE* logout;
+extern FILE* errorout;
+
+// lexer log verbosity, selected at runtime through the LOG_LEVEL environment variable
+// off: nothing, errors: lexical errors only, tokens (default): errors and tokens,
+// full: every token, comment, string and error line followed by the lexer rule that matched
+// and what it was taken for, an error also says what is wrong
+// the parser's rule lines are written by the grammar and do not depend on the level
+enum LogLevel { LOG_OFF, LOG_ERRORS, LOG_TOKENS, LOG_FULL };
+LogLevel logLevel = LOG_TOKENS;
+
+#define LOG_BUFFER_SIZE (1 << 16)
+char logBuffer[LOG_BUFFER_SIZE];
+
+void initLog() {
+    const char* level = getenv("LOG_LEVEL");
+    if (level != NULL) {
+        if (strcmp(level, "off") == 0) logLevel = LOG_OFF;
+        else if (strcmp(level, "errors") == 0) logLevel = LOG_ERRORS;
+        else if (strcmp(level, "tokens") == 0) logLevel = LOG_TOKENS;
+        else if (strcmp(level, "full") == 0) logLevel = LOG_FULL;
+    }
+
+    // nothing is written to the log before the first token is requested
+    setvbuf(logout, logBuffer, _IOFBF, LOG_BUFFER_SIZE);
+}
+
+// the detail line of LOG_LEVEL=full
+void logDetail(const char* rule, const char* detail) {
+    fprintf(logout, "\trule %s: %s\n", rule, detail);
+}
+
+void tokenDetail(const char* lexeme, const char* token);
+void errorDetail(const char* errorCode);
+
+void action(const char* lexeme, const char* token) {
+    if (logLevel < LOG_TOKENS) return;
+    fprintf(logout, "Line# %d: Token <%s> Lexeme %s found\n", yylineno, token, lexeme);
+    if (logLevel == LOG_FULL) tokenDetail(lexeme, token);
+}
+
+void detectError(const char* errorCode, const char* lexeme) {
+    errorCount++;
+    if (logLevel < LOG_ERRORS) return;
+    fprintf(logout, "Error at line# %d: %s %s\n", yylineno, errorCode, lexeme);
+    if (logLevel == LOG_FULL) errorDetail(errorCode);
+}
+
+// the next token, defined by the lexer that is linked in
+int scanToken();
+
+int yylex() {
+    compilerStats.startParse();
+    PhaseTimer timer(PHASE_LEX);
+    int token = scanToken();
+    if (token != 0) compilerStats.tokens++;
+    return token;
+}
+
+// keywords are scanned by the {ID} rule and classified with a perfect hash over
+// (length, first character, last character), hash parameters and slots are found at compile time
+
+struct Keyword {
+    const char* lexeme;
+    TokenKind kind;
+    const char* typeSpecifier;
+    int token;
+};
+
+constexpr Keyword keywords[] = {
+    {"if", TOKEN_IF, "", IF},
+    {"else", TOKEN_ELSE, "", ELSE},
+    {"for", TOKEN_FOR, "", FOR},
+    {"while", TOKEN_WHILE, "", WHILE},
+    {"do", TOKEN_DO, "", DO},
+    {"break", TOKEN_BREAK, "", BREAK},
+    {"int", TOKEN_INT, "INT", INT},
+    {"char", TOKEN_CHAR, "CHAR", CHAR},
+    {"float", TOKEN_FLOAT, "FLOAT", FLOAT},
+    {"double", TOKEN_DOUBLE, "DOUBLE", DOUBLE},
+    {"void", TOKEN_VOID, "VOID", VOID},
+    {"return", TOKEN_RETURN, "", RETURN},
+    {"switch", TOKEN_SWITCH, "", SWITCH},
+    {"case", TOKEN_CASE, "", CASE},
+    {"default", TOKEN_DEFAULT, "", DEFAULT},
+    {"continue", TOKEN_CONTINUE, "", CONTINUE},
+    {"println", TOKEN_PRINTLN, "", PRINTLN}};
+
+constexpr int keywordCount = sizeof(keywords) / sizeof(keywords[0]);
+
+#define KEYWORD_TABLE_SIZE 32
+
+constexpr int constLength(const char* s) {
+    int length = 0;
+    while (s[length] != '\0') length++;
+    return length;
+}
+
+struct KeywordHash {
+    int lengthFactor, charFactor;
+
+    constexpr unsigned operator()(const char* s, int length) const {
+        return (length * lengthFactor + ((unsigned char)s[0] + (unsigned char)s[length - 1]) * charFactor) % KEYWORD_TABLE_SIZE;
+    }
+};
+
+constexpr KeywordHash findKeywordHash() {
+    for (int lengthFactor = 1; lengthFactor < 16; lengthFactor++) {
+        for (int charFactor = 1; charFactor < 16; charFactor++) {
+            KeywordHash hash = {lengthFactor, charFactor};
+            bool used[KEYWORD_TABLE_SIZE] = {};
+            bool perfect = true;
+
+            for (int i = 0; i < keywordCount && perfect; i++) {
+                unsigned slot = hash(keywords[i].lexeme, constLength(keywords[i].lexeme));
+                perfect = !used[slot];
+                used[slot] = true;
+            }
+            if (perfect) return hash;
+        }
+    }
+    return {0, 0};
+}
+
+constexpr KeywordHash keywordHash = findKeywordHash();
+static_assert(keywordHash.lengthFactor != 0, "no perfect hash for the keyword table");
+
+struct KeywordTable {
+    int slots[KEYWORD_TABLE_SIZE];
+};
+
+constexpr KeywordTable buildKeywordTable() {
+    KeywordTable table = {};
+    for (int i = 0; i < KEYWORD_TABLE_SIZE; i++) table.slots[i] = -1;
+    for (int i = 0; i < keywordCount; i++) {
+        table.slots[keywordHash(keywords[i].lexeme, constLength(keywords[i].lexeme))] = i;
+    }
+    return table;
+}
+
+constexpr KeywordTable keywordTable = buildKeywordTable();
+
+// the keyword spelled by an identifier lexeme, NULL for a plain identifier
+inline const Keyword* findKeyword(const char* lexeme, int length) {
+    int slot = keywordTable.slots[keywordHash(lexeme, length)];
+    if (slot == -1 || strcmp(lexeme, keywords[slot].lexeme) != 0) return NULL;
+    return &keywords[slot];
+}
+
+void tokenDetail(const char* lexeme, const char* token) {
+    if (strcmp(token, "CONST_INT") == 0) {
+        logDetail("{DIGIT}+", "integer constant, type INT");
+    } else if (strcmp(token, "CONST_FLOAT") == 0) {
+        logDetail("{NUMBER}", "floating point constant, type FLOAT");
+    } else if (strcmp(token, "CONST_CHAR") == 0) {
+        logDetail("{CHAR}", "character constant, type CHAR");
+    } else if (strcmp(token, "ID") == 0) {
+        logDetail("{ID}", "identifier");
+    } else if (const Keyword* keyword = findKeyword(lexeme, strlen(lexeme))) {
+        logDetail("{ID}", keyword->typeSpecifier[0] != '\0' ? "keyword, type specifier" : "keyword");
+    } else {
+        string rule = string("\"") + lexeme + "\"";
+        logDetail(rule.c_str(), "operator or punctuation");
+    }
+}
+
+struct ErrorDetail {
+    const char* errorCode;
+    const char* rule;
+    const char* detail;
+};
+
+const ErrorDetail errorDetails[] = {
+    {"TOO_MANY_DECIMAL_POINTS", "{TOO_MANY_DECIMAL_POINTS}", "a number with more than one decimal point"},
+    {"ILLFORMED_NUMBER", "{ILLFORMED_NUMBER}", "a number followed by another one, such as a fractional exponent"},
+    {"INVALID_ID_SUFFIX_NUM_PREFIX", "{INVALID_ID_SUFFIX_NUM_PREFIX}", "an identifier that starts with a digit"},
+    {"MULTICHAR_CONST_CHAR", "{CHAR}", "more than one character between single quotes"},
+    {"EMPTY_CONST_CHAR", "\"''\"", "nothing between single quotes"},
+    {"UNFINISHED_CONST_CHAR", "{UNFINISHED_CONST_CHAR}", "a character constant without its closing quote"},
+    {"UNFINISHED_STRING", "{UNFINISHED_STRING}", "a string without its closing quote on the same line"},
+    {"UNRECOGNIZED CHAR", "[^ \\r\\n\\t]", "a character no other rule accepts"}};
+
+void errorDetail(const char* errorCode) {
+    if (strcmp(errorCode, "UNFINISHED_COMMENT") == 0) {
+        string detail = "a comment opened on line " + to_string(commentBeginLine) + " and not closed before the end of the file";
+        logDetail("<COMMENT><<EOF>>", detail.c_str());
+        return;
+    }
+    for (auto& error : errorDetails) {
+        if (strcmp(errorCode, error.errorCode) == 0) logDetail(error.rule, error.detail);
+    }
+}
+
+string convertEscape(char c) {
+    switch (c) {
+        case '\'':
+            return "\'";
+        case '"':
+            return "\"";
+        case 'n':
+            return "\n";
+        case 't':
+            return "\t";
+        case '\\':
+            return "\\";
+        case 'a':
+            return "\a";
+        case 'f':
+            return "\f";
+        case 'r':
+            return "\r";
+        case 'b':
+            return "\b";
+        case 'v':
+            return "\v";
+        case '0':
+            return "\0";
+        default:
+            return "";
+    }
+}
+
+#endif
@@ -0,0 +1,620 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "classes/symbolInfo.h"
+#include "classes/symbolTable.h"
+#include "y.tab.hpp"
+#include "1905018_lexer.h"
+
+// hand written replacement for the flex generated lexer (lex.yy.cpp), make scanner_test diffs the two
+// the patterns of 1905018.l are compiled once into a DFA over character classes,
+// matched with the same longest-match / first-rule priority as flex.
+// whitespace runs and comment bodies are skipped 16 bytes at a time with SSE2
+
+using namespace std;
+
+FILE* yyin = NULL;
+int yylineno = 1;
+char* yytext = NULL;
+int yyleng = 0;
+
+/* pattern definitions, same as 1905018.l */
+
+const map<string, string> definitions{
+    {"WHITESPACE", R"([ \t\n\r\v]+)"},
+    {"LETTER", R"([a-zA-Z])"},
+    {"DIGIT", R"([0-9])"},
+    {"NUMBER", R"([0-9]*(\.[0-9]+)?(E[-+]?[0-9]+)|[0-9]*\.[0-9]+(E[-+]?[0-9]+)?)"},
+    {"NEWLINE", R"([\n])"},
+    {"ID", R"(({LETTER}|[_])({LETTER}|{DIGIT}|_)*)"},
+    {"CHAR", R"(\'([^'\\\n]|\\['"nt\\abfrv])+\')"},
+    {"STRING", R"(\"([^"\n]|\\\n|\\['"nt\\abfrv])*\")"},
+    {"SINGLE_LINE_COMMENT", R"(\/\/([^\n]|\\\n)*)"},
+    {"TOO_MANY_DECIMAL_POINTS", R"([0-9]*\.[0-9]*(\.[0-9]*)+(E[-+]?[0-9]+)?)"},
+    {"ILLFORMED_NUMBER", R"({NUMBER}+)"},
+    {"INVALID_ID_SUFFIX_NUM_PREFIX", R"([0-9]+{ID})"},
+    {"UNFINISHED_CONST_CHAR", R"(\'[^\n\']|\'\\'|')"},
+    {"UNFINISHED_STRING", R"(\"([^"\n]|\\\n|\\['"nt\\abfrv])*)"}};
+
+/* rules, in the order of 1905018.l */
+
+enum RuleKind {
+    RULE_TOKEN,  // log, build a SymbolInfo and return the token
+    RULE_ERROR,  // report a lexical error
+    RULE_ID,     // keyword or identifier
+    RULE_NEWLINE,
+    RULE_WHITESPACE,
+    RULE_CHAR,
+    RULE_COMMENT,
+    RULE_SINGLE_LINE_COMMENT,
+    RULE_STRING
+};
+
+struct ScannerRule {
+    const char* pattern;
+    RuleKind kind;
+    const char* errorCode = NULL;
+    TokenKind tokenKind = TOKEN_NONE;
+    const char* typeSpecifier = "";
+    int token = 0;
+};
+
+const ScannerRule rules[] = {
+    {R"({NEWLINE})", RULE_NEWLINE},
+    {R"({WHITESPACE})", RULE_WHITESPACE},
+
+    {R"({DIGIT}+)", RULE_TOKEN, NULL, TOKEN_CONST_INT, "INT", CONST_INT},
+    {R"({NUMBER})", RULE_TOKEN, NULL, TOKEN_CONST_FLOAT, "FLOAT", CONST_FLOAT},
+    {R"({TOO_MANY_DECIMAL_POINTS})", RULE_ERROR, "TOO_MANY_DECIMAL_POINTS"},
+    {R"({ILLFORMED_NUMBER})", RULE_ERROR, "ILLFORMED_NUMBER"},
+    {R"({INVALID_ID_SUFFIX_NUM_PREFIX})", RULE_ERROR, "INVALID_ID_SUFFIX_NUM_PREFIX"},
+    {R"({CHAR})", RULE_CHAR},
+    {R"("''")", RULE_ERROR, "EMPTY_CONST_CHAR"},
+    {R"({UNFINISHED_CONST_CHAR})", RULE_ERROR, "UNFINISHED_CONST_CHAR"},
+    {R"("/*")", RULE_COMMENT},
+    {R"({SINGLE_LINE_COMMENT})", RULE_SINGLE_LINE_COMMENT},
+
+    {R"("++")", RULE_TOKEN, NULL, TOKEN_INCOP, "", INCOP},
+    {R"("--")", RULE_TOKEN, NULL, TOKEN_DECOP, "", DECOP},
+    {R"(">="|"<="|"=="|"!=")", RULE_TOKEN, NULL, TOKEN_RELOP, "", RELOP},
+    {R"("&&"|"||")", RULE_TOKEN, NULL, TOKEN_LOGICOP, "", LOGICOP},
+    {R"("<<"|">>")", RULE_TOKEN, NULL, TOKEN_BITOP, "", BITOP},
+    {R"("+"|"-")", RULE_TOKEN, NULL, TOKEN_ADDOP, "", ADDOP},
+    {R"("*"|"/"|"%")", RULE_TOKEN, NULL, TOKEN_MULOP, "", MULOP},
+    {R"("<"|">")", RULE_TOKEN, NULL, TOKEN_RELOP, "", RELOP},
+    {R"("=")", RULE_TOKEN, NULL, TOKEN_ASSIGNOP, "", ASSIGNOP},
+    {R"("&"|"|"|"^")", RULE_TOKEN, NULL, TOKEN_BITOP, "", BITOP},
+    {R"("!")", RULE_TOKEN, NULL, TOKEN_NOT, "", NOT},
+    {R"("(")", RULE_TOKEN, NULL, TOKEN_LPAREN, "", LPAREN},
+    {"\")\"", RULE_TOKEN, NULL, TOKEN_RPAREN, "", RPAREN},
+    {R"("{")", RULE_TOKEN, NULL, TOKEN_LCURL, "", LCURL},
+    {R"("}")", RULE_TOKEN, NULL, TOKEN_RCURL, "", RCURL},
+    {R"("[")", RULE_TOKEN, NULL, TOKEN_LSQUARE, "", LSQUARE},
+    {R"("]")", RULE_TOKEN, NULL, TOKEN_RSQUARE, "", RSQUARE},
+    {R"(",")", RULE_TOKEN, NULL, TOKEN_COMMA, "", COMMA},
+    {R"(";")", RULE_TOKEN, NULL, TOKEN_SEMICOLON, "", SEMICOLON},
+    {R"({ID})", RULE_ID},
+
+    {R"({STRING})", RULE_STRING},
+    {R"({UNFINISHED_STRING})", RULE_ERROR, "UNFINISHED_STRING"},
+    {R"([^ \r\n\t])", RULE_ERROR, "UNRECOGNIZED CHAR"}};
+
+const int ruleCount = sizeof(rules) / sizeof(rules[0]);
+
+/* regular expression -> NFA (Thompson construction) */
+
+struct NfaState {
+    vector<int> epsilon;
+    vector<bool> chars;  // 256 entries when the state has a character edge
+    int next = -1;
+    int rule = -1;  // accepting state of this rule
+};
+
+vector<NfaState> nfa;
+
+struct Fragment {
+    int start, end;
+};
+
+int newNfaState() {
+    nfa.push_back(NfaState());
+    return nfa.size() - 1;
+}
+
+Fragment charFragment(const vector<bool>& chars) {
+    Fragment f = {newNfaState(), newNfaState()};
+    nfa[f.start].chars = chars;
+    nfa[f.start].next = f.end;
+    return f;
+}
+
+class RegexParser {
+    // recursive descent over the subset of flex regular expressions used in 1905018.l
+   private:
+    string regex;
+    int pos = 0;
+
+    bool atEnd() { return pos >= (int)regex.length(); }
+
+    char escape(char c) {
+        switch (c) {
+            case 'n':
+                return '\n';
+            case 't':
+                return '\t';
+            case 'r':
+                return '\r';
+            case 'v':
+                return '\v';
+            default:
+                return c;
+        }
+    }
+
+    Fragment parseAlternation() {
+        Fragment left = parseConcatenation();
+        while (!atEnd() && regex[pos] == '|') {
+            pos++;
+            Fragment right = parseConcatenation();
+            Fragment f = {newNfaState(), newNfaState()};
+            nfa[f.start].epsilon = {left.start, right.start};
+            nfa[left.end].epsilon.push_back(f.end);
+            nfa[right.end].epsilon.push_back(f.end);
+            left = f;
+        }
+        return left;
+    }
+
+    Fragment parseConcatenation() {
+        int start = newNfaState();
+        Fragment f = {start, start};
+        while (!atEnd() && regex[pos] != '|' && regex[pos] != ')') {
+            Fragment next = parseRepetition();
+            nfa[f.end].epsilon.push_back(next.start);
+            f.end = next.end;
+        }
+        return f;
+    }
+
+    Fragment parseRepetition() {
+        Fragment f = parseAtom();
+        while (!atEnd() && (regex[pos] == '*' || regex[pos] == '+' || regex[pos] == '?')) {
+            char op = regex[pos++];
+            Fragment g = {newNfaState(), newNfaState()};
+            nfa[g.start].epsilon.push_back(f.start);
+            nfa[f.end].epsilon.push_back(g.end);
+            if (op != '+') nfa[g.start].epsilon.push_back(g.end);
+            if (op != '?') nfa[f.end].epsilon.push_back(f.start);
+            f = g;
+        }
+        return f;
+    }
+
+    Fragment parseAtom() {
+        char c = regex[pos++];
+
+        if (c == '(') {
+            Fragment f = parseAlternation();
+            pos++;  // ')'
+            return f;
+        }
+
+        if (c == '{') {
+            // definitions are substituted as if in parentheses
+            int close = regex.find('}', pos);
+            string name = regex.substr(pos, close - pos);
+            pos = close + 1;
+            return RegexParser(definitions.at(name)).parse();
+        }
+
+        if (c == '"') {
+            int start = newNfaState();
+            Fragment f = {start, start};
+            while (regex[pos] != '"') {
+                vector<bool> chars(256, false);
+                chars[(unsigned char)regex[pos++]] = true;
+                Fragment next = charFragment(chars);
+                nfa[f.end].epsilon.push_back(next.start);
+                f.end = next.end;
+            }
+            pos++;
+            return f;
+        }
+
+        if (c == '[') {
+            vector<bool> chars(256, false);
+            bool negate = regex[pos] == '^';
+            if (negate) pos++;
+
+            while (regex[pos] != ']') {
+                char low = regex[pos++];
+                if (low == '\\') low = escape(regex[pos++]);
+
+                char high = low;
+                if (regex[pos] == '-' && regex[pos + 1] != ']') {
+                    pos++;
+                    high = regex[pos++];
+                    if (high == '\\') high = escape(regex[pos++]);
+                }
+                for (int i = (unsigned char)low; i <= (unsigned char)high; i++) chars[i] = true;
+            }
+            pos++;
+
+            if (negate) chars.flip();
+            return charFragment(chars);
+        }
+
+        vector<bool> chars(256, false);
+        if (c == '.') {
+            chars.flip();
+            chars['\n'] = false;
+        } else {
+            if (c == '\\') c = escape(regex[pos++]);
+            chars[(unsigned char)c] = true;
+        }
+        return charFragment(chars);
+    }
+
+   public:
+    RegexParser(string regex) { this->regex = regex; }
+
+    Fragment parse() { return parseAlternation(); }
+};
+
+/* NFA -> DFA (subset construction) */
+
+vector<int> charClass(256, 0);
+int charClassCount = 1;
+vector<int> transitions;  // [state * charClassCount + class], -1 when dead
+vector<int> acceptRule;   // rule matched when the longest match ends in this state
+int startState;
+bool scannerBuilt = false;
+
+void closure(vector<int>& states) {
+    vector<bool> seen(nfa.size(), false);
+    vector<int> stack = states;
+    for (int s : states) seen[s] = true;
+
+    while (!stack.empty()) {
+        int s = stack.back();
+        stack.pop_back();
+        for (int t : nfa[s].epsilon) {
+            if (!seen[t]) {
+                seen[t] = true;
+                states.push_back(t);
+                stack.push_back(t);
+            }
+        }
+    }
+    sort(states.begin(), states.end());
+}
+
+void buildScanner() {
+    int start = newNfaState();
+    for (int i = 0; i < ruleCount; i++) {
+        Fragment f = RegexParser(rules[i].pattern).parse();
+        nfa[start].epsilon.push_back(f.start);
+        nfa[f.end].rule = i;
+    }
+
+    // split the characters into classes that no edge tells apart
+    for (auto& state : nfa) {
+        if (state.next == -1) continue;
+        map<pair<int, bool>, int> refined;
+        for (int c = 0; c < 256; c++) {
+            auto key = make_pair(charClass[c], (bool)state.chars[c]);
+            if (!refined.count(key)) {
+                int id = refined.size();
+                refined[key] = id;
+            }
+            charClass[c] = refined[key];
+        }
+        charClassCount = refined.size();
+    }
+    vector<int> representative(charClassCount);
+    for (int c = 255; c >= 0; c--) representative[charClass[c]] = c;
+
+    map<vector<int>, int> dfaStates;
+    vector<vector<int>> pending;
+
+    auto addState = [&](vector<int>& states) {
+        closure(states);
+        if (dfaStates.count(states)) return dfaStates[states];
+
+        int id = dfaStates.size();
+        dfaStates[states] = id;
+        pending.push_back(states);
+
+        int rule = -1;
+        for (int s : states) {
+            if (nfa[s].rule != -1 && (rule == -1 || nfa[s].rule < rule)) rule = nfa[s].rule;
+        }
+        acceptRule.push_back(rule);
+        transitions.resize(transitions.size() + charClassCount, -1);
+        return id;
+    };
+
+    vector<int> initial = {start};
+    startState = addState(initial);
+
+    for (int id = 0; id < (int)pending.size(); id++) {
+        vector<int> states = pending[id];
+        for (int cls = 0; cls < charClassCount; cls++) {
+            vector<int> next;
+            for (int s : states) {
+                if (nfa[s].next != -1 && nfa[s].chars[representative[cls]]) next.push_back(nfa[s].next);
+            }
+            if (next.empty()) continue;
+            sort(next.begin(), next.end());
+            next.erase(unique(next.begin(), next.end()), next.end());
+            int target = addState(next);
+            transitions[id * charClassCount + cls] = target;
+        }
+    }
+
+    nfa.clear();
+    scannerBuilt = true;
+}
+
+/* input buffer */
+
+vector<char> buffer;
+int position = 0, bufferEnd = 0;
+char holdChar = '\0';
+bool textHeld = false;
+bool inComment = false;
+
+void readInput() {
+    FILE* in = (yyin == NULL) ? stdin : yyin;
+    char chunk[1 << 16];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        buffer.insert(buffer.end(), chunk, chunk + n);
+    }
+    bufferEnd = buffer.size();
+    // padding so that 16 byte loads never run past the buffer
+    buffer.resize(bufferEnd + 16, '\0');
+}
+
+inline bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v';
+}
+
+// end of the whitespace run starting at from
+int skipWhitespace(int from) {
+    int i = from;
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), newline = _mm_set1_epi8('\n');
+    const __m128i carriageReturn = _mm_set1_epi8('\r'), verticalTab = _mm_set1_epi8('\v');
+    while (i + 16 <= bufferEnd) {
+        __m128i block = _mm_loadu_si128((const __m128i*)&buffer[i]);
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(block, newline),
+                                               _mm_or_si128(_mm_cmpeq_epi8(block, carriageReturn), _mm_cmpeq_epi8(block, verticalTab))));
+        unsigned mask = ~_mm_movemask_epi8(ws) & 0xFFFF;
+        if (mask) return i + __builtin_ctz(mask);
+        i += 16;
+    }
+#endif
+    while (i < bufferEnd && isWhitespace(buffer[i])) i++;
+    return i;
+}
+
+// position of the next '*' at or after from, bufferEnd if there is none
+int findStar(int from) {
+    int i = from;
+#ifdef __SSE2__
+    const __m128i star = _mm_set1_epi8('*');
+    while (i + 16 <= bufferEnd) {
+        __m128i block = _mm_loadu_si128((const __m128i*)&buffer[i]);
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, star));
+        if (mask) return i + __builtin_ctz(mask);
+        i += 16;
+    }
+#endif
+    while (i < bufferEnd && buffer[i] != '*') i++;
+    return i;
+}
+
+int countNewlines(int from, int to) {
+    int count = 0;
+    for (int i = from; i < to; i++) {
+        if (buffer[i] == '\n') count++;
+    }
+    return count;
+}
+
+// makes buffer[from, to) the current yytext, NUL terminated in place
+void setText(int from, int to) {
+    yytext = &buffer[from];
+    yyleng = to - from;
+    holdChar = buffer[to];
+    buffer[to] = '\0';
+    textHeld = true;
+    position = to;
+}
+
+void restoreText() {
+    if (textHeld) buffer[position] = holdChar;
+    textHeld = false;
+}
+
+/* scanner */
+
+// <COMMENT> state: "*/" ends the comment, everything else is appended to commentString
+// returns false on an unfinished comment
+bool scanComment() {
+    while (position < bufferEnd) {
+        int star = findStar(position);
+        int newlines = countNewlines(position, star);
+        lineCount += newlines;
+        yylineno += newlines;
+        commentString.append(&buffer[position], star - position);
+        position = star;
+
+        if (star >= bufferEnd) break;
+
+        if (star + 1 < bufferEnd && buffer[star + 1] == '/') {
+            position = star + 2;
+            if (logLevel >= LOG_TOKENS) {
+                fprintf(logout, "Line# %d: Token <MULTI LINE COMMENT> Lexeme %s*/ found\n", commentBeginLine, commentString.c_str());
+                if (logLevel == LOG_FULL) logDetail("\"/*\"", "comment, skipped");
+            }
+            inComment = false;
+            return true;
+        }
+
+        commentString += '*';
+        position++;
+    }
+
+    // the <<EOF>> rule of 1905018.l echoes yytext, which flex leaves empty at the end of the input
+    setText(bufferEnd, bufferEnd);
+    cout << yytext;
+    detectError("UNFINISHED_COMMENT", commentString.c_str());
+    return false;
+}
+
+int scanToken() {
+    if (!scannerBuilt) {
+        initLog();
+        buildScanner();
+        readInput();
+    }
+
+    restoreText();
+
+    while (true) {
+        if (inComment && !scanComment()) return 0;
+        if (position >= bufferEnd) return 0;
+
+        if (isWhitespace(buffer[position])) {
+            // {NEWLINE} wins over {WHITESPACE} only for a lone '\n'
+            int end = skipWhitespace(position);
+            if (end - position == 1 && buffer[position] == '\n') lineCount++;
+            yylineno += countNewlines(position, end);
+            position = end;
+            continue;
+        }
+
+        // longest match, first rule on ties
+        int state = startState, matchedRule = -1, matchEnd = position;
+        for (int i = position; i < bufferEnd; i++) {
+            state = transitions[state * charClassCount + charClass[(unsigned char)buffer[i]]];
+            if (state == -1) break;
+            if (acceptRule[state] != -1) {
+                matchedRule = acceptRule[state];
+                matchEnd = i + 1;
+            }
+        }
+
+        if (matchedRule == -1) {
+            // no rule matches, flex would echo the character
+            putchar(buffer[position++]);
+            continue;
+        }
+
+        int newlines = countNewlines(position, matchEnd);
+        setText(position, matchEnd);
+        yylineno += newlines;
+
+        const ScannerRule& rule = rules[matchedRule];
+        switch (rule.kind) {
+            case RULE_TOKEN: {
+                action(yytext, tokenNames[rule.tokenKind]);
+                SymbolInfo* s = new SymbolInfo(yytext, rule.tokenKind, rule.typeSpecifier);
+                s->setStartLine(yylineno);
+                yylval = (YYSTYPE)s;
+                return rule.token;
+            }
+
+            case RULE_ID: {
+                const Keyword* keyword = findKeyword(yytext, yyleng);
+                TokenKind kind = (keyword != NULL) ? keyword->kind : TOKEN_ID;
+
+                action(yytext, tokenNames[kind]);
+                SymbolInfo* s = new SymbolInfo(yytext, kind, (keyword != NULL) ? keyword->typeSpecifier : "");
+                s->setStartLine(yylineno);
+                yylval = (YYSTYPE)s;
+                return (keyword != NULL) ? keyword->token : ID;
+            }
+
+            case RULE_ERROR:
+                detectError(rule.errorCode, yytext);
+                break;
+
+            case RULE_NEWLINE:
+                lineCount++;
+                break;
+
+            case RULE_WHITESPACE:
+                break;
+
+            case RULE_CHAR:
+                if (yytext[1] == '\\') {
+                    // escape characters
+                    action(convertEscape(yytext[2]).c_str(), "CONST_CHAR");
+                    return CONST_CHAR;
+                } else if (strlen(yytext) > 3) {
+                    // multichar character
+                    detectError("MULTICHAR_CONST_CHAR", yytext);
+                } else {
+                    // normal character
+                    action(string(1, yytext[1]).c_str(), "CONST_CHAR");
+                }
+                break;
+
+            case RULE_COMMENT:
+                commentBeginLine = yylineno;
+                commentString = "/*";
+                inComment = true;
+                break;
+
+            case RULE_SINGLE_LINE_COMMENT:
+                if (logLevel >= LOG_TOKENS) {
+                    fprintf(logout, "Line# %d: Token <SINGLE LINE COMMENT> Lexeme %s found\n", lineCount, yytext);
+                    if (logLevel == LOG_FULL) logDetail("{SINGLE_LINE_COMMENT}", "comment, skipped");
+                }
+
+                for (int i = 0; yytext[i] != '\0'; i++) {
+                    if (yytext[i] == '\\' && yytext[i + 1] == '\n') {
+                        lineCount++;
+                    }
+                }
+                break;
+
+            case RULE_STRING: {
+                bool multiLine = false;
+                int beginLine = lineCount;
+
+                for (int i = 1; yytext[i] != '\"'; i++) {
+                    if (yytext[i] == '\\' && yytext[i + 1] == '\n') {
+                        lineCount++;
+                        multiLine = true;
+                        i++;
+                    } else if (yytext[i] == '\\') {
+                        i++;
+                    }
+                }
+
+                if (logLevel >= LOG_TOKENS) {
+                    fprintf(logout, "Line# %d: Token <%s> Lexeme %s found\n", beginLine, multiLine ? "MULTI LINE STRING" : "SINGLE LINE STRING", yytext);
+                    if (logLevel == LOG_FULL) logDetail("{STRING}", "string, skipped");
+                }
+                break;
+            }
+        }
+
+        restoreText();
+    }
+}
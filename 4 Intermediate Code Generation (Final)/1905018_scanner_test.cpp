@@ -0,0 +1,69 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "classes/symbolInfo.h"
+#include "classes/symbolTable.h"
+#include "y.tab.hpp"
+
+// runs the linked lexer alone, for the differential test of the flex lexer and the hand written scanner
+// every token is written as: line, token number, lexeme, type specifier; the lexer's log is written
+// as the compiler writes it, and the token count and tokens per second go to stderr
+
+// linked with lex.yy.cpp (flex) or with 1905018_scanner.cpp, see make scanner_test
+// ./scanner_test file.c tokens.txt log.txt
+
+using namespace std;
+
+YYSTYPE yylval;
+SymbolTable* symbolTable = new SymbolTable();
+FILE* logout;
+FILE* errorout;
+
+extern FILE* yyin;
+extern int yylineno;
+extern int errorCount;
+int yylex();
+
+void yyerror(string s) {
+    errorCount++;
+    fprintf(errorout, "Line# %d: %s\n", yylineno, s.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s file.c tokens.txt log.txt\n", argv[0]);
+        return 1;
+    }
+    yyin = fopen(argv[1], "r");
+    FILE* tokensOut = fopen(argv[2], "w");
+    logout = fopen(argv[3], "w");
+    errorout = fopen("/dev/null", "w");
+    if (yyin == NULL || tokensOut == NULL || logout == NULL || errorout == NULL) {
+        fprintf(stderr, "Cannot open the input or the output files\n");
+        return 1;
+    }
+
+    long tokens = 0;
+    auto start = chrono::steady_clock::now();
+    while (true) {
+        yylval = nullptr;
+        int token = yylex();
+        if (token == 0) break;
+        tokens++;
+        if (yylval == nullptr) {
+            fprintf(tokensOut, "%d\t%d\n", yylineno, token);
+        } else {
+            fprintf(tokensOut, "%d\t%d\t%s\t%s\n", yylineno, token, yylval->getName().c_str(), yylval->getTypeSpecifier().c_str());
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    fprintf(logout, "Total Lines: %d\nTotal Errors: %d\n", yylineno, errorCount);
+
+    fclose(tokensOut);
+    fclose(logout);
+    fprintf(stderr, "%s: %ld tokens in %.3f s, %.0f tokens/s\n", argv[1], tokens, seconds, tokens / seconds);
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// writes a valid program of the compiled C subset to stdout, sized by the options
+// -f functions     function definitions besides main
+// -d depth         nesting of loops and ifs in each function
+// -g globals       global int variables
+// -a arrays        global and local arrays (0 turns array use off)
+// -e depth         depth of every generated expression
+// -c collisions    locals per function that land in the same ScopeTable bucket
+// -s seed          seed of the random choices, the same options and seed give the same program
+
+// g++ -O2 -o benchmark/generator benchmark/generator.cpp
+// ./benchmark/generator -f 1000 -d 3 > big.c
+
+using namespace std;
+
+// bucket count of the compiler's symbol table (DEFAULT_BUCKET_SIZE)
+#define BUCKET_SIZE 31
+#define ARRAY_SIZE 8
+
+struct Options {
+    int functions = 100;
+    int depth = 2;
+    int globals = 10;
+    int arrays = 2;
+    int expressionDepth = 3;
+    int collisions = 0;
+    int seed = 1;
+};
+
+Options options;
+mt19937 randomEngine;
+
+// same hash as ScopeTable::SDBMHash
+unsigned long long bucketOf(string name) {
+    unsigned long long hash = 0;
+    for (char c : name) hash = c + (hash << 6) + (hash << 16) - hash;
+    return hash % BUCKET_SIZE;
+}
+
+int randomInt(int n) {
+    return uniform_int_distribution<int>(0, n - 1)(randomEngine);
+}
+
+// variables an expression of the current function can use
+struct Scope {
+    vector<string> scalars;
+    vector<string> arrays;
+    int function;  // index of the function being generated, calls go to earlier ones
+};
+
+string expression(Scope& scope, int depth);
+
+string operand(Scope& scope) {
+    int choice = randomInt(4);
+    if (choice == 0 || scope.scalars.empty()) return to_string(randomInt(100));
+    if (choice == 1 && !scope.arrays.empty()) {
+        return scope.arrays[randomInt(scope.arrays.size())] + "[" + to_string(randomInt(ARRAY_SIZE)) + "]";
+    }
+    return scope.scalars[randomInt(scope.scalars.size())];
+}
+
+string expression(Scope& scope, int depth) {
+    if (depth <= 0) return operand(scope);
+
+    switch (randomInt(6)) {
+        case 0:
+            return expression(scope, depth - 1) + " + " + expression(scope, depth - 1);
+        case 1:
+            return expression(scope, depth - 1) + " - " + expression(scope, depth - 1);
+        case 2:
+            return "(" + expression(scope, depth - 1) + ") * " + operand(scope);
+        case 3:
+            return "(" + expression(scope, depth - 1) + ") % 7";
+        case 4:
+            if (scope.function > 0) {
+                string callee = "f" + to_string(randomInt(scope.function));
+                return callee + "(" + expression(scope, depth - 1) + ", " + operand(scope) + ")";
+            }
+            return "-" + operand(scope);
+        default:
+            return "(" + expression(scope, depth - 1) + " < " + operand(scope) + " || " + operand(scope) + " == 3)";
+    }
+}
+
+string target(Scope& scope) {
+    if (!scope.arrays.empty() && randomInt(3) == 0) {
+        return scope.arrays[randomInt(scope.arrays.size())] + "[" + to_string(randomInt(ARRAY_SIZE)) + "]";
+    }
+    // the first scalars are the parameters, keep them intact
+    return scope.scalars[2 + randomInt(scope.scalars.size() - 2)];
+}
+
+void statements(Scope& scope, int depth, string indent) {
+    printf("%s%s = %s;\n", indent.c_str(), target(scope).c_str(), expression(scope, options.expressionDepth).c_str());
+    if (depth <= 0) return;
+
+    string inner = indent + "    ";
+    switch (randomInt(3)) {
+        case 0:
+            // one counter per level, nested loops must not reset the outer one
+            printf("%sfor (i%d = 0; i%d < %d; i%d++) {\n", indent.c_str(), depth, depth, 1 + randomInt(5), depth);
+            statements(scope, depth - 1, inner);
+            printf("%s}\n", indent.c_str());
+            break;
+        case 1:
+            printf("%sw = %d;\n%swhile (w > 0) {\n", indent.c_str(), 1 + randomInt(5), indent.c_str());
+            statements(scope, depth - 1, inner);
+            printf("%sw--;\n%s}\n", inner.c_str(), indent.c_str());
+            break;
+        default:
+            printf("%sif (%s > %d) {\n", indent.c_str(), expression(scope, 1).c_str(), randomInt(50));
+            statements(scope, depth - 1, inner);
+            printf("%s} else {\n", indent.c_str());
+            statements(scope, depth - 1, inner);
+            printf("%s}\n", indent.c_str());
+    }
+    printf("%s%s = %s;\n", indent.c_str(), target(scope).c_str(), expression(scope, options.expressionDepth).c_str());
+}
+
+// names that fall into one bucket, so that their lookups walk the same chain
+vector<string> collidingNames(int count) {
+    vector<string> names;
+    unsigned long long bucket = bucketOf("c0");
+    for (int i = 0; (int)names.size() < count; i++) {
+        string name = "c" + to_string(i);
+        if (bucketOf(name) == bucket) names.push_back(name);
+    }
+    return names;
+}
+
+void function(int index, vector<string>& globals, vector<string>& globalArrays) {
+    Scope scope;
+    scope.function = index;
+    scope.scalars = {"a", "b", "x", "y"};
+    scope.arrays = globalArrays;
+
+    printf("int f%d(int a, int b) {\n", index);
+    printf("    int w, x, y");
+    for (int i = 1; i <= options.depth; i++) printf(", i%d", i);
+    printf(";\n");
+    for (int i = 0; i < options.arrays; i++) {
+        printf("    int l%d[%d];\n", i, ARRAY_SIZE);
+        scope.arrays.push_back("l" + to_string(i));
+    }
+    vector<string> colliding = collidingNames(options.collisions);
+    for (auto name : colliding) {
+        printf("    int %s;\n", name.c_str());
+        scope.scalars.push_back(name);
+    }
+    scope.scalars.insert(scope.scalars.end(), globals.begin(), globals.end());
+
+    for (auto name : colliding) printf("    %s = %d;\n", name.c_str(), randomInt(10));
+    printf("    x = a;\n    y = b;\n");
+    statements(scope, options.depth, "    ");
+    printf("    return x;\n}\n");
+}
+
+void usage(char* program) {
+    cerr << "usage: " << program << " [-f functions] [-d depth] [-g globals] [-a arrays] [-e depth] [-c collisions] [-s seed]\n";
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc || argv[i][0] != '-' || strlen(argv[i]) != 2) usage(argv[0]);
+        int value = atoi(argv[++i]);
+        switch (argv[i - 1][1]) {
+            case 'f': options.functions = value; break;
+            case 'd': options.depth = value; break;
+            case 'g': options.globals = value; break;
+            case 'a': options.arrays = value; break;
+            case 'e': options.expressionDepth = value; break;
+            case 'c': options.collisions = value; break;
+            case 's': options.seed = value; break;
+            default: usage(argv[0]);
+        }
+    }
+    randomEngine.seed(options.seed);
+
+    vector<string> globals, globalArrays;
+    for (int i = 0; i < options.globals; i++) {
+        printf("int g%d;\n", i);
+        globals.push_back("g" + to_string(i));
+    }
+    for (int i = 0; i < options.arrays; i++) {
+        printf("int ga%d[%d];\n", i, ARRAY_SIZE);
+        globalArrays.push_back("ga" + to_string(i));
+    }
+
+    for (int i = 0; i < options.functions; i++) function(i, globals, globalArrays);
+
+    printf("int main() {\n    int r;\n    r = 0;\n");
+    for (int i = 0; i < options.functions; i++) printf("    r = r + f%d(r, %d);\n", i, i);
+    printf("    println(r);\n    return 0;\n}\n");
+    return 0;
+}
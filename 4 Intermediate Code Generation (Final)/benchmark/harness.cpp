@@ -0,0 +1,229 @@
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+// compiles generated programs of growing size and records time, memory and code size per stage
+// every run appends one line per case to the results file, tagged with the current commit,
+// and is compared with the latest results of an earlier commit (or of -b commit)
+// a case slower, bigger or using more memory than the threshold fails the run
+
+// g++ -O2 -o benchmark/harness benchmark/harness.cpp
+// ./benchmark/harness [-c compiler] [-g generator] [-o results] [-b commit] [-t percent] [-r repeats]
+
+using namespace std;
+
+struct Case {
+    string name;
+    string options;  // generator options
+};
+
+const vector<Case> cases = {
+    {"small", "-f 10 -d 2"},
+    {"functions", "-f 2000 -d 1 -e 2"},
+    {"nesting", "-f 50 -d 8"},
+    {"globals", "-f 200 -g 500"},
+    {"arrays", "-f 200 -a 20"},
+    {"expressions", "-f 50 -e 9"},
+    {"collisions", "-f 200 -c 40"},
+};
+
+// measured values, in the order they are written
+const vector<string> metrics = {"lex_ms", "parse_ms", "parse_tree_ms", "codegen_ms", "total_ms", "peak_rss_kb", "asm_bytes"};
+
+// the number after "key": in a flat search of the report
+double jsonNumber(const string& json, string key) {
+    size_t at = json.find("\"" + key + "\": ");
+    if (at == string::npos) return 0;
+    return strtod(json.c_str() + at + key.size() + 4, NULL);
+}
+
+double phaseWall(const string& json, string phase) {
+    size_t at = json.find("\"" + phase + "\": {");
+    if (at == string::npos) return 0;
+    return jsonNumber(json.substr(at), "wall_ms");
+}
+
+string runCommand(string command) {
+    string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == NULL) return output;
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), pipe) != NULL) output += buffer;
+    pclose(pipe);
+    return output;
+}
+
+// compiles source inside dir, with the statistics report written to dir/stats.json
+bool compile(string compiler, string dir, string source) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (chdir(dir.c_str()) != 0) _exit(127);
+        FILE* stats = freopen("stats.json", "w", stderr);
+        FILE* out = freopen("/dev/null", "w", stdout);
+        if (stats == NULL || out == NULL) _exit(127);
+        setenv("COMPILER_STATS", "json", 1);
+        execl(compiler.c_str(), compiler.c_str(), source.c_str(), (char*)NULL);
+        _exit(127);
+    }
+    int status;
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+map<string, double> measure(string compiler, string dir, string source, int repeats) {
+    map<string, double> result;
+    for (int i = 0; i < repeats; i++) {
+        if (!compile(compiler, dir, source)) return {};
+
+        ifstream in(dir + "/stats.json");
+        string json((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        struct stat st;
+        stat((dir + "/1905018_code.asm").c_str(), &st);
+
+        map<string, double> run = {
+            {"lex_ms", phaseWall(json, "lex")},
+            {"parse_ms", phaseWall(json, "parse")},
+            {"parse_tree_ms", phaseWall(json, "parse tree")},
+            {"codegen_ms", phaseWall(json, "codegen")},
+            {"total_ms", phaseWall(json, "total")},
+            {"peak_rss_kb", jsonNumber(json, "peak_rss_kb")},
+            {"asm_bytes", (double)st.st_size}};
+
+        // the fastest run is the least disturbed one
+        for (auto& metric : run) {
+            if (i == 0 || metric.second < result[metric.first]) result[metric.first] = metric.second;
+        }
+    }
+    return result;
+}
+
+struct Record {
+    string commit, name;
+    map<string, double> values;
+};
+
+vector<Record> readResults(string path) {
+    vector<Record> records;
+    ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        Record record;
+        size_t commit = line.find("\"commit\": \""), name = line.find("\"case\": \"");
+        if (commit == string::npos || name == string::npos) continue;
+        record.commit = line.substr(commit + 11, line.find('"', commit + 11) - commit - 11);
+        record.name = line.substr(name + 9, line.find('"', name + 9) - name - 9);
+        for (auto metric : metrics) record.values[metric] = jsonNumber(line, metric);
+        records.push_back(record);
+    }
+    return records;
+}
+
+void usage(char* program) {
+    cerr << "usage: " << program << " [-c compiler] [-g generator] [-o results] [-b commit] [-t percent] [-r repeats]\n";
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    string compiler = "./1905018";
+    string generator = "./benchmark/generator";
+    string resultsPath = "benchmark/results.jsonl";
+    string baseline = "";
+    double threshold = 10;
+    int repeats = 3;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) usage(argv[0]);
+        if (strcmp(argv[i], "-c") == 0) compiler = argv[++i];
+        else if (strcmp(argv[i], "-g") == 0) generator = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0) resultsPath = argv[++i];
+        else if (strcmp(argv[i], "-b") == 0) baseline = argv[++i];
+        else if (strcmp(argv[i], "-t") == 0) threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0) repeats = max(1, atoi(argv[++i]));
+        else usage(argv[0]);
+    }
+
+    char resolved[PATH_MAX];
+    if (realpath(compiler.c_str(), resolved) == NULL) {
+        cerr << "Cannot find the compiler " << compiler << "\n";
+        return 1;
+    }
+    compiler = resolved;
+
+    string commit = runCommand("git rev-parse --short HEAD 2>/dev/null");
+    if (!commit.empty() && commit.back() == '\n') commit.pop_back();
+    if (commit.empty()) commit = "unknown";
+    if (runCommand("git status --porcelain --untracked-files=no 2>/dev/null") != "") commit += "-dirty";
+
+    vector<Record> previous = readResults(resultsPath);
+    ofstream results(resultsPath, ios::app);
+    results.precision(12);
+
+    char dirTemplate[] = "/tmp/benchmark_XXXXXX";
+    string dir = mkdtemp(dirTemplate);
+
+    bool regressed = false;
+    printf("%-12s", "case");
+    for (auto metric : metrics) printf(" %14s", metric.c_str());
+    printf("\n");
+
+    for (auto& c : cases) {
+        string source = dir + "/" + c.name + ".c";
+        if (system((generator + " " + c.options + " > " + source).c_str()) != 0) {
+            cerr << "Cannot generate " << c.name << "\n";
+            return 1;
+        }
+
+        map<string, double> values = measure(compiler, dir, source, repeats);
+        if (values.empty()) {
+            cerr << "failed: " << c.name << "\n";
+            regressed = true;
+            continue;
+        }
+
+        // the latest result of the baseline commit, or of any other commit
+        const Record* base = NULL;
+        for (auto& record : previous) {
+            if (record.name != c.name) continue;
+            if (baseline != "" ? record.commit == baseline : record.commit != commit) base = &record;
+        }
+
+        results << "{\"commit\": \"" << commit << "\", \"case\": \"" << c.name << "\"";
+        printf("%-12s", c.name.c_str());
+        for (auto metric : metrics) {
+            results << ", \"" << metric << "\": " << values[metric];
+
+            string change = "";
+            if (base != NULL && base->values.at(metric) > 0) {
+                double percent = 100 * (values[metric] - base->values.at(metric)) / base->values.at(metric);
+                char buffer[32];
+                snprintf(buffer, sizeof(buffer), "(%+.0f%%)", percent);
+                change = buffer;
+                // phases of a few milliseconds are mostly noise
+                bool measurable = metric.find("_ms") == string::npos || base->values.at(metric) >= 5;
+                if (percent > threshold && measurable) {
+                    change += "!";
+                    regressed = true;
+                }
+            }
+            printf(" %8.0f%-6s", values[metric], change.c_str());
+        }
+        results << "}\n";
+        printf("\n");
+    }
+
+    system(("rm -rf " + dir).c_str());
+    if (regressed) printf("regression over %.0f%% (marked with !)\n", threshold);
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,189 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../classes/symbolTable.h"
+
+// micro-benchmarks of the compiler's SymbolTable and ScopeTable
+// every workload is run for each bucket size, name length and scope depth,
+// and reported in ns/op and heap allocations/op
+
+// g++ -O2 -o benchmark/symbolTable benchmark/symbolTable.cpp
+// ./benchmark/symbolTable [-n names] [-r repeats]
+
+using namespace std;
+
+// every allocation goes through these, so a workload's allocations are counted
+long long allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == NULL) throw bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+struct NameLength {
+    const char* name;
+    int shortest, longest;
+};
+
+const int bucketSizes[] = {7, 31, 127};
+const NameLength nameLengths[] = {{"short", 1, 4}, {"medium", 8, 16}, {"long", 32, 64}};
+const int scopeDepths[] = {1, 8, 32};
+
+int nameCount = 1000;
+int repeats = 5;
+
+// keeps results alive so that the compiler does not drop the work
+volatile uintptr_t sink;
+
+vector<string> makeNames(int count, NameLength length, mt19937& engine) {
+    set<string> unique;
+    vector<string> names;
+    while ((int)names.size() < count) {
+        int size = uniform_int_distribution<int>(length.shortest, length.longest)(engine);
+        string name(size, 'a');
+        for (auto& c : name) c = 'a' + uniform_int_distribution<int>(0, 25)(engine);
+        // a single letter name space is small, fall back to numbered names
+        if (unique.count(name)) name += to_string(names.size());
+        if (unique.insert(name).second) names.push_back(name);
+    }
+    return names;
+}
+
+struct Result {
+    double nsPerOp;
+    double allocationsPerOp;
+};
+
+// runs prepare untimed and work timed, repeats times, and keeps the fastest run
+template <typename Prepare, typename Work, typename Cleanup>
+Result measure(int ops, Prepare prepare, Work work, Cleanup cleanup) {
+    Result best = {1e300, 0};
+    for (int r = 0; r < repeats; r++) {
+        prepare();
+        long long allocationsBefore = allocations;
+        auto start = chrono::steady_clock::now();
+        work();
+        auto end = chrono::steady_clock::now();
+        long long allocated = allocations - allocationsBefore;
+        cleanup();
+
+        double ns = chrono::duration<double, nano>(end - start).count() / ops;
+        if (ns < best.nsPerOp) best = {ns, (double)allocated / ops};
+    }
+    return best;
+}
+
+void report(const char* workload, int buckets, const char* length, int depth, Result result) {
+    printf("%-12s %8d %8s %6d %12.1f %12.2f\n", workload, buckets, length, depth, result.nsPerOp, result.allocationsPerOp);
+}
+
+// the tables leak the symbols of a scope when it is removed, the benchmarks remove them first
+void removeAll(SymbolTable* table, const vector<string>& names) {
+    for (auto& name : names) table->remove(name);
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0) nameCount = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-r") == 0) repeats = atoi(argv[i + 1]);
+    }
+
+    mt19937 engine(1);
+    printf("%-12s %8s %8s %6s %12s %12s\n", "workload", "buckets", "names", "depth", "ns/op", "allocs/op");
+
+    for (int buckets : bucketSizes) {
+        for (auto length : nameLengths) {
+            vector<string> names = makeNames(nameCount, length, engine);
+            vector<string> missing = makeNames(nameCount, length, engine);
+            for (auto& name : missing) name += "#";  // never inserted
+
+            SymbolTable* table = nullptr;
+
+            // insert into the current scope
+            Result insert = measure(
+                nameCount, [&]() { table = new SymbolTable(buckets); },
+                [&]() {
+                    for (auto& name : names) sink = table->insert(name, "ID");
+                },
+                [&]() {
+                    removeAll(table, names);
+                    delete table;
+                });
+            report("insert", buckets, length.name, 1, insert);
+
+            // remove from the current scope
+            Result remove = measure(
+                nameCount,
+                [&]() {
+                    table = new SymbolTable(buckets);
+                    for (auto& name : names) table->insert(name, "ID");
+                },
+                [&]() {
+                    for (auto& name : names) sink = table->remove(name);
+                },
+                [&]() { delete table; });
+            report("delete", buckets, length.name, 1, remove);
+
+            for (int depth : scopeDepths) {
+                // names in the outermost scope, found after searching depth - 1 scopes of one name each
+                auto prepare = [&]() {
+                    table = new SymbolTable(buckets);
+                    for (auto& name : names) table->insert(name, "ID");
+                    for (int d = 1; d < depth; d++) {
+                        table->enterScope();
+                        table->insert("scope" + to_string(d), "ID");
+                    }
+                };
+                auto cleanup = [&]() {
+                    for (int d = depth - 1; d >= 1; d--) {
+                        table->remove("scope" + to_string(d));
+                        table->exitScope();
+                    }
+                    removeAll(table, names);
+                    delete table;
+                };
+
+                Result hit = measure(
+                    nameCount, prepare,
+                    [&]() {
+                        for (auto& name : names) sink = (uintptr_t)table->lookup(name);
+                    },
+                    cleanup);
+                report("lookup hit", buckets, length.name, depth, hit);
+
+                Result miss = measure(
+                    nameCount, prepare,
+                    [&]() {
+                        for (auto& name : missing) sink = (uintptr_t)table->lookup(name);
+                    },
+                    cleanup);
+                report("lookup miss", buckets, length.name, depth, miss);
+
+                // enter depth scopes and leave them again
+                Result scopes = measure(
+                    nameCount * depth, [&]() { table = new SymbolTable(buckets); },
+                    [&]() {
+                        for (int i = 0; i < nameCount; i++) {
+                            for (int d = 0; d < depth; d++) table->enterScope();
+                            for (int d = 0; d < depth; d++) table->exitScope();
+                        }
+                    },
+                    [&]() { delete table; });
+                report("enter/exit", buckets, length.name, depth, scopes);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+#ifndef COMPILER_STATS
+#define COMPILER_STATS
+
+#include <sys/resource.h>
+#include <time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+// phase timings and counters, reported on stderr at exit when COMPILER_STATS is "text" or "json"
+// counters are always kept, timers only run when the report is enabled
+
+enum Phase { PHASE_LEX, PHASE_PARSE, PHASE_SYMBOL_TABLE, PHASE_PARSE_TREE, PHASE_CODEGEN, PHASE_COUNT };
+
+constexpr const char* phaseNames[] = {"lex", "parse", "symbol table", "parse tree", "codegen"};
+
+inline double clockMs(clockid_t clock) {
+    timespec t;
+    clock_gettime(clock, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+struct CompilerStats {
+    bool enabled = false;
+    bool json = false;
+
+    double wall[PHASE_COUNT] = {};
+    double cpu[PHASE_COUNT] = {};
+    double startWall, startCpu;
+    double parseStartWall = -1, parseStartCpu;
+
+    long long tokens = 0;
+    long long reductions = 0;  // rules reduced, counted as the parser builds their nodes
+    long long lookups = 0;
+    long long lookupProbes = 0;  // symbols compared, over every scope searched
+    long long enterScopes = 0;
+    long long exitScopes = 0;
+    long long instructions = 0;
+    long long labels = 0;
+    bool codeSegment = false;  // whether the output being counted is after .CODE
+
+    CompilerStats() {
+        const char* report = getenv("COMPILER_STATS");
+        enabled = report != NULL && (strcmp(report, "text") == 0 || strcmp(report, "json") == 0);
+        json = enabled && strcmp(report, "json") == 0;
+        startWall = clockMs(CLOCK_MONOTONIC);
+        startCpu = clockMs(CLOCK_PROCESS_CPUTIME_ID);
+    }
+
+    ~CompilerStats() {
+        if (enabled) report();
+    }
+
+    // lexing, parsing and the symbol table work of the parser actions are interleaved, parse time
+    // is measured from the first token until the parse tree is printed, less the time spent in the
+    // lexer and the symbol table
+    void startParse() {
+        if (parseStartWall >= 0) return;
+        parseStartWall = clockMs(CLOCK_MONOTONIC);
+        parseStartCpu = clockMs(CLOCK_PROCESS_CPUTIME_ID);
+    }
+
+    void endParse() {
+        if (!enabled || parseStartWall < 0) return;
+        wall[PHASE_PARSE] = clockMs(CLOCK_MONOTONIC) - parseStartWall - wall[PHASE_LEX] - wall[PHASE_SYMBOL_TABLE];
+        cpu[PHASE_PARSE] = clockMs(CLOCK_PROCESS_CPUTIME_ID) - parseStartCpu - cpu[PHASE_LEX] - cpu[PHASE_SYMBOL_TABLE];
+    }
+
+    void countInstructions(const char* code) {
+        if (!enabled) return;
+        // instructions are the lines indented by a tab in the code segment,
+        // the indented lines of .DATA are definitions and directives
+        bool lineStart = true;
+        for (const char* c = code; *c != '\0'; c++) {
+            if (lineStart && *c == '.') codeSegment = strncmp(c, ".CODE", 5) == 0;
+            if (lineStart && *c == '\t' && codeSegment) instructions++;
+            lineStart = *c == '\n';
+        }
+    }
+
+    void report() {
+        double totalWall = clockMs(CLOCK_MONOTONIC) - startWall;
+        double totalCpu = clockMs(CLOCK_PROCESS_CPUTIME_ID) - startCpu;
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        double averageProbes = lookups > 0 ? (double)lookupProbes / lookups : 0;
+
+        if (json) {
+            fprintf(stderr, "{\"phases\": {");
+            for (int i = 0; i < PHASE_COUNT; i++) {
+                fprintf(stderr, "\"%s\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}, ", phaseNames[i], wall[i], cpu[i]);
+            }
+            fprintf(stderr, "\"total\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}}, ", totalWall, totalCpu);
+            fprintf(stderr, "\"tokens\": %lld, \"reductions\": %lld, \"lookups\": %lld, \"average_lookup_probes\": %.3f, ",
+                    tokens, reductions, lookups, averageProbes);
+            fprintf(stderr, "\"enter_scopes\": %lld, \"exit_scopes\": %lld, \"instructions\": %lld, \"labels\": %lld, ",
+                    enterScopes, exitScopes, instructions, labels);
+            fprintf(stderr, "\"peak_rss_kb\": %ld}\n", usage.ru_maxrss);
+            return;
+        }
+
+        fprintf(stderr, "%-12s %12s %12s\n", "phase", "wall (ms)", "cpu (ms)");
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            fprintf(stderr, "%-12s %12.3f %12.3f\n", phaseNames[i], wall[i], cpu[i]);
+        }
+        fprintf(stderr, "%-12s %12.3f %12.3f\n\n", "total", totalWall, totalCpu);
+        fprintf(stderr, "tokens         %lld\n", tokens);
+        fprintf(stderr, "reductions     %lld\n", reductions);
+        fprintf(stderr, "lookups        %lld (%.3f probes on average)\n", lookups, averageProbes);
+        fprintf(stderr, "scopes         %lld entered, %lld exited\n", enterScopes, exitScopes);
+        fprintf(stderr, "instructions   %lld\n", instructions);
+        fprintf(stderr, "labels         %lld\n", labels);
+        fprintf(stderr, "peak memory    %ld KB\n", usage.ru_maxrss);
+    }
+};
+
+inline CompilerStats compilerStats;
+
+// adds the time until the end of the scope to a phase
+class PhaseTimer {
+    Phase phase;
+    double wall, cpu;
+
+   public:
+    PhaseTimer(Phase phase) : phase(phase) {
+        if (!compilerStats.enabled) return;
+        wall = clockMs(CLOCK_MONOTONIC);
+        cpu = clockMs(CLOCK_PROCESS_CPUTIME_ID);
+    }
+
+    ~PhaseTimer() {
+        if (!compilerStats.enabled) return;
+        compilerStats.wall[phase] += clockMs(CLOCK_MONOTONIC) - wall;
+        compilerStats.cpu[phase] += clockMs(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+    }
+};
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef SCOPE_TABLE
 #define SCOPE_TABLE
 
+#include "compilerStats.h"
 #include "symbolInfo.h"
 using namespace std;
 
@@ -115,6 +116,7 @@ class ScopeTable {
         SymbolInfo* symbolInfo = scopeTable[hashValue];
 
         while (symbolInfo != nullptr) {
+            compilerStats.lookupProbes++;
             if (symbolInfo->getName() == name) {
                 // cout << "\t'" << name << "' found in ScopeTable# " << id << " at position " << (hashValue + 1) << ", " << position << endl;
                 return symbolInfo;
@@ -2,12 +2,58 @@
 #define SYMBOL_INFO
 
 #include <iostream>
-#include <set>
 #include <vector>
 
+#include "compilerStats.h"
+
 using namespace std;
 
-const set<string> terminals{
+// terminals of the grammar (and the error token), nodes built by the lexer carry one of these kinds
+enum TokenKind {
+    TOKEN_IF,
+    TOKEN_ELSE,
+    TOKEN_FOR,
+    TOKEN_WHILE,
+    TOKEN_DO,
+    TOKEN_BREAK,
+    TOKEN_INT,
+    TOKEN_CHAR,
+    TOKEN_FLOAT,
+    TOKEN_DOUBLE,
+    TOKEN_VOID,
+    TOKEN_RETURN,
+    TOKEN_SWITCH,
+    TOKEN_CASE,
+    TOKEN_DEFAULT,
+    TOKEN_CONTINUE,
+    TOKEN_CONST_INT,
+    TOKEN_CONST_FLOAT,
+    TOKEN_CONST_CHAR,
+    TOKEN_INCOP,
+    TOKEN_LOGICOP,
+    TOKEN_ADDOP,
+    TOKEN_MULOP,
+    TOKEN_RELOP,
+    TOKEN_ASSIGNOP,
+    TOKEN_BITOP,
+    TOKEN_NOT,
+    TOKEN_LPAREN,
+    TOKEN_RPAREN,
+    TOKEN_LCURL,
+    TOKEN_RCURL,
+    TOKEN_LSQUARE,
+    TOKEN_RSQUARE,
+    TOKEN_COMMA,
+    TOKEN_SEMICOLON,
+    TOKEN_ID,
+    TOKEN_PRINTLN,
+    TOKEN_DECOP,
+    TOKEN_THEN,
+    TOKEN_ERROR,
+    TOKEN_NONE  // non-terminal
+};
+
+constexpr const char* tokenNames[] = {
     "IF",
     "ELSE",
     "FOR",
@@ -47,7 +93,23 @@ const set<string> terminals{
     "PRINTLN",
     "DECOP",
     "THEN",
-    "error"};
+    "error",
+    ""};
+
+static_assert(sizeof(tokenNames) / sizeof(tokenNames[0]) == TOKEN_NONE + 1, "a name for every token kind");
+
+// terminals are the leaves of the parse tree
+constexpr bool isLeafKind(TokenKind kind) { return kind != TOKEN_NONE; }
+
+// the kind a type string names, TOKEN_NONE for a non-terminal or a symbol
+// non-terminal names are lower case, so only the other ones are looked up
+inline TokenKind tokenKindOf(const string& type) {
+    if (type.empty() || (type[0] >= 'a' && type[0] <= 'z' && type != "error")) return TOKEN_NONE;
+    for (int kind = 0; kind < TOKEN_NONE; kind++) {
+        if (type == tokenNames[kind]) return (TokenKind)kind;
+    }
+    return TOKEN_NONE;
+}
 
 class SymbolInfo {
     // entry of hash value
@@ -56,6 +118,7 @@ class SymbolInfo {
     string name = "", type = "", returnType = "", typeSpecifier = "", sType = "";
     SymbolInfo* prev = nullptr;
     SymbolInfo* next = nullptr;
+    TokenKind kind = TOKEN_NONE;
 
     bool functionDefinition = false;
     bool functionDeclaration = false;
@@ -73,8 +136,10 @@ class SymbolInfo {
 
    public:
     int stackBuffer = 0;
+    string registerName = "";  // a parameter kept in a register instead of the stack
     int exitLabel;
 
+    // non-terminals and symbols, a type that names a terminal makes a leaf of that kind
     SymbolInfo(string name = "", string type = "", string typeSpecifier = "", string returnType = "", int size = 0) {
         this->name = name;
         this->type = type;
@@ -84,14 +149,22 @@ class SymbolInfo {
         this->size = size;
         this->next = nullptr;
         this->prev = nullptr;
-
-        if (terminals.count(type)) {
-            this->leaf = true;
-        }
+        this->kind = tokenKindOf(type);
+        this->leaf = isLeafKind(this->kind);
+    }
+    // terminals, built by the lexer without looking the type up
+    SymbolInfo(string name, TokenKind kind, string typeSpecifier = "") {
+        this->name = name;
+        this->type = tokenNames[kind];
+        this->sType = this->type;
+        this->typeSpecifier = typeSpecifier;
+        this->kind = kind;
+        this->leaf = isLeafKind(kind);
     }
     SymbolInfo(SymbolInfo* symbolInfo) {
         name = symbolInfo->name;
         type = symbolInfo->type;
+        kind = symbolInfo->kind;
         sType = symbolInfo->sType;
         returnType = symbolInfo->returnType;
         typeSpecifier = symbolInfo->typeSpecifier;
@@ -110,6 +183,7 @@ class SymbolInfo {
     string getType() { return type; }
     string getReturnType() { return returnType; }
     string getTypeSpecifier() { return typeSpecifier; }
+    TokenKind getKind() { return kind; }
     int getSize() { return size; }
     SymbolInfo* getPrev() { return prev; }
     SymbolInfo* getNext() { return next; }
@@ -125,7 +199,10 @@ class SymbolInfo {
         if (s == "INT" || s == "FLOAT" || s == "DOUBLE") {
             typeSpecifier = s;
         }
-        if (s == "error") leaf = true;
+        if (s == "error") {
+            kind = TOKEN_ERROR;
+            leaf = true;
+        }
     }
     void setReturnType(string s) {
         returnType = s;
@@ -150,7 +227,9 @@ class SymbolInfo {
 
     // functions for building parse tree
     void setParent(SymbolInfo* parent) { this->parent = parent; }
+    // every rule of the grammar builds its node through here, once per reduction
     void setChildren(vector<SymbolInfo*> children) {
+        compilerStats.reductions++;
         this->children = children;
         if (children.size() > 0) {
             endLine = children[children.size() - 1]->endLine;
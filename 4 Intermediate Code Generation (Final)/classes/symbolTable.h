@@ -19,6 +19,7 @@ class SymbolTable {
     SymbolTable(int bucketSize = DEFAULT_BUCKET_SIZE) {
         scopeCount = 0;
         currentScope = nullptr;
+        scopeStack = nullptr;
         this->bucketSize = bucketSize;
         this->enterScope();
     }
@@ -32,7 +33,10 @@ class SymbolTable {
         return scopeCount;
     }
 
+    // the symbol table work of the parser actions is timed on its own
     void enterScope() {
+        PhaseTimer timer(PHASE_SYMBOL_TABLE);
+        compilerStats.enterScopes++;
         ScopeTable* temp = new ScopeTable(bucketSize, ++scopeCount);
 
         if (currentScope == nullptr) {
@@ -44,6 +48,8 @@ class SymbolTable {
     }
 
     void exitScope() {
+        PhaseTimer timer(PHASE_SYMBOL_TABLE);
+        compilerStats.exitScopes++;
         if (currentScope->getId() == 1) {
             return;
         }
@@ -62,18 +68,23 @@ class SymbolTable {
     }
 
     bool insert(string name, string type) {
+        PhaseTimer timer(PHASE_SYMBOL_TABLE);
         return currentScope->insert(name, type);
     }
 
     bool insert(SymbolInfo*& info) const {
+        PhaseTimer timer(PHASE_SYMBOL_TABLE);
         return currentScope->insert(info);
     }
 
     bool remove(string name) {
+        PhaseTimer timer(PHASE_SYMBOL_TABLE);
         return currentScope->deleteEntry(name);
     }
 
     SymbolInfo* lookup(string name) {
+        PhaseTimer timer(PHASE_SYMBOL_TABLE);
+        compilerStats.lookups++;
         ScopeTable* temp = currentScope;
 
         while (temp != nullptr) {
@@ -92,10 +103,12 @@ class SymbolTable {
     // }
 
     string printCurrentScope() {
+        PhaseTimer timer(PHASE_SYMBOL_TABLE);
         return currentScope->print();
     }
 
     string printAllScope() {
+        PhaseTimer timer(PHASE_SYMBOL_TABLE);
         ScopeTable* temp = currentScope;
         string ret = "";
 
@@ -7,7 +7,7 @@ int main() {
     println(i);  // -2
     x[1] = w[0]++;
     i = x[1];
-    println(i);  // -1
+    println(i);  // -2
     i = w[0];
     println(i);  // -1
 
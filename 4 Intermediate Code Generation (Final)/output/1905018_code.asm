@@ -3,14 +3,19 @@
 .DATA
 	CR EQU 0DH
 	LF EQU 0AH
-	NUMBER DB "00000$"
-	w DW 0
-	TEN DW 10
+	OUTPUT_SIZE EQU 256
+	NUMBER DB 6 DUP(0)
+	DIGITS DB "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899"
+	OUTPUT_BUFFER DB OUTPUT_SIZE DUP(0)
+	EVEN
+	OUTPUT_LENGTH DW 0
+	w DW 10 DUP(0)
 .CODE
 
 main PROC
 	MOV AX, @DATA
 	MOV DS, AX
+	MOV ES, AX
 	PUSH BP
 	MOV BP, SP
 ; var_declaration: line-3
@@ -20,34 +25,30 @@ main PROC
 	MOV AX, 0
 	MOV BX, AX
 	SHL BX, 1
-	ADD BX, 0
-	NEG BX
-	ADD BX, w
+	PUSH BX
 	MOV AX, 2
 	NEG AX
-	MOV [BX], AX
+	POP BX
+	MOV [w+BX], AX
 ; assignment: line-5
 	MOV AX, 0
 	MOV BX, AX
 	SHL BX, 1
-	ADD BX, 4
-	NEG BX
 	ADD BX, BP
+	SUB BX, 22
+	PUSH BX
 	MOV AX, 0
 	MOV BX, AX
 	SHL BX, 1
-	ADD BX, 0
-	NEG BX
-	ADD BX, w
-	MOV AX, [BX]
+	MOV AX, [w+BX]
+	POP BX
 	MOV [BX], AX
 ; assignment: line-6
 	MOV AX, 0
 	MOV BX, AX
 	SHL BX, 1
-	ADD BX, 4
-	NEG BX
 	ADD BX, BP
+	SUB BX, 22
 	MOV AX, [BX]
 	MOV [BP-2], AX
 ; print: line-7
@@ -58,24 +59,22 @@ main PROC
 	MOV AX, 1
 	MOV BX, AX
 	SHL BX, 1
-	ADD BX, 4
-	NEG BX
 	ADD BX, BP
+	SUB BX, 22
+	PUSH BX
 	MOV AX, 0
 	MOV BX, AX
 	SHL BX, 1
-	ADD BX, 0
-	NEG BX
-	ADD BX, w
-	INC [BX]
+	MOV AX, [w+BX]
+	INC [w+BX]
+	POP BX
 	MOV [BX], AX
 ; assignment: line-9
 	MOV AX, 1
 	MOV BX, AX
 	SHL BX, 1
-	ADD BX, 4
-	NEG BX
 	ADD BX, BP
+	SUB BX, 22
 	MOV AX, [BX]
 	MOV [BP-2], AX
 ; print: line-10
@@ -86,10 +85,7 @@ main PROC
 	MOV AX, 0
 	MOV BX, AX
 	SHL BX, 1
-	ADD BX, 0
-	NEG BX
-	ADD BX, w
-	MOV AX, [BX]
+	MOV AX, [w+BX]
 	MOV [BP-2], AX
 ; print: line-12
 	MOV AX, [BP-2]
@@ -240,56 +236,90 @@ L4:
 	JMP L1
 L1:
 	ADD SP, 22
+	CALL flush_output
 	POP BP
-	MOV AX, 4CH
+	MOV AX, 4C00H
 	INT 21H
 main ENDP
 new_line PROC
-	PUSH AX
-	PUSH DX
-	MOV AH, 2
-	MOV DL, CR
-	INT 21H
-	MOV AH, 2
-	MOV DL, LF
-	INT 21H
-	POP DX
-	POP AX
+	PUSH BX
+	CMP OUTPUT_LENGTH, OUTPUT_SIZE-2
+	JBE NEW_LINE_ROOM
+	CALL flush_output
+NEW_LINE_ROOM:
+	MOV BX, OUTPUT_LENGTH
+	MOV BYTE PTR OUTPUT_BUFFER[BX], CR
+	MOV BYTE PTR OUTPUT_BUFFER[BX+1], LF
+	ADD OUTPUT_LENGTH, 2
+	POP BX
 	RET
 new_line ENDP
 print_output PROC
 	PUSH AX
+	PUSH BX
 	PUSH CX
 	PUSH DX
 	PUSH SI
-	LEA SI,NUMBER
-	ADD SI,4
-	CMP AX,0
-	JNGE NEGATE
-PRINT:
-	XOR DX,DX
-	DIV TEN
-	MOV [SI],DL
-	ADD [SI],'0'
-	DEC SI
-	CMP AX,0
-	JNE PRINT
+	PUSH DI
+	CMP OUTPUT_LENGTH, OUTPUT_SIZE-8
+	JBE PRINT_ROOM
+	CALL flush_output
+PRINT_ROOM:
+	MOV DI, OFFSET OUTPUT_BUFFER
+	ADD DI, OUTPUT_LENGTH
+	CMP AX, 0
+	JGE PRINT_DIGITS
+	MOV BYTE PTR [DI], '-'
+	INC DI
+	NEG AX
+PRINT_DIGITS:
+	MOV SI, OFFSET NUMBER+6
+	MOV CX, 100
+PRINT_PAIR:
+	XOR DX, DX
+	DIV CX
+	MOV BX, DX
+	SHL BX, 1
+	MOV DX, WORD PTR DIGITS[BX]
+	SUB SI, 2
+	MOV [SI], DX
+	CMP AX, 0
+	JNE PRINT_PAIR
+	CMP BYTE PTR [SI], '0'
+	JNE PRINT_COPY
 	INC SI
-	LEA DX,SI
-	MOV AH,9
-	INT 21H
+PRINT_COPY:
+	MOV CX, OFFSET NUMBER+6
+	SUB CX, SI
+	CLD
+	REP MOVSB
+	SUB DI, OFFSET OUTPUT_BUFFER
+	MOV OUTPUT_LENGTH, DI
+	POP DI
 	POP SI
 	POP DX
 	POP CX
+	POP BX
 	POP AX
 	RET
-NEGATE:
+print_output ENDP
+flush_output PROC
 	PUSH AX
-	MOV AH,02H
-	MOV DL,'-'
+	PUSH BX
+	PUSH CX
+	PUSH DX
+	MOV CX, OUTPUT_LENGTH
+	JCXZ FLUSH_DONE
+	MOV AH, 40H
+	MOV BX, 1
+	MOV DX, OFFSET OUTPUT_BUFFER
 	INT 21H
+	MOV OUTPUT_LENGTH, 0
+FLUSH_DONE:
+	POP DX
+	POP CX
+	POP BX
 	POP AX
-	NEG AX
-	JMP PRINT
-print_output ENDP
+	RET
+flush_output ENDP
 END main
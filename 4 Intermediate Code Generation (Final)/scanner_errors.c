@@ -0,0 +1,32 @@
+// lexical errors and unusual tokens, for make scanner_test
+int main() {
+    float a, b;
+    int c;
+    a = 1.2.3;
+    b = 1..5E3;
+    a = 1E5.5;
+    b = 12E;
+    a = 1.5E3E2;
+    c = 12abc;
+    c = 3_x;
+    c = 'ab';
+    c = 'a';
+    c = '\n';
+    c = '';
+    c = 'x
+    c = '\';
+    char *s = "a string with \"escapes\" and a \
+continued line";
+    s = "unfinished string
+    s = "unfinished \
+across lines
+    c = a @ b # c;
+    c = 0.5 + .5 + 5. + 5E-3 + 5e3;
+    /* a comment
+       over lines */
+    // a single line comment \
+    continued
+    return 0;
+}
+/* an unfinished comment
+int x;